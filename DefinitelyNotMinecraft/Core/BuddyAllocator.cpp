@@ -0,0 +1,91 @@
+#include "Core/BuddyAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace dnm
+{
+BuddyAllocator::BuddyAllocator(u64 size, u64 minRangeSize) : m_size {size}, m_minRangeSize {minRangeSize} {
+    assert(std::has_single_bit(size) && std::has_single_bit(minRangeSize) && minRangeSize <= size);
+
+    m_freeRanges.resize(getLevel(size) + 1u);
+    m_freeRanges.back().insert(0u);
+}
+
+std::optional<u64> BuddyAllocator::allocate(u64 size) {
+    const u32 level = getLevel(size);
+    if (level >= m_freeRanges.size()) {
+        return std::nullopt;
+    }
+
+    u32 freeLevel = level;
+    while (freeLevel < m_freeRanges.size() && m_freeRanges [freeLevel].empty()) {
+        ++freeLevel;
+    }
+    if (freeLevel == m_freeRanges.size()) {
+        return std::nullopt;
+    }
+
+    const u64 offset = *m_freeRanges [freeLevel].begin();
+    m_freeRanges [freeLevel].erase(m_freeRanges [freeLevel].begin());
+
+    // Split until the range has the requested size, the upper halves stay free
+    while (freeLevel > level) {
+        --freeLevel;
+        m_freeRanges [freeLevel].insert(offset + (m_minRangeSize << freeLevel));
+    }
+
+    m_usedSize += m_minRangeSize << level;
+    return offset;
+}
+
+void BuddyAllocator::free(u64 offset, u64 size) {
+    u32 level = getLevel(size);
+    assert(offset % (m_minRangeSize << level) == 0u);
+    m_usedSize -= m_minRangeSize << level;
+
+    // Merge with the buddy as long as it is free as well
+    while (level + 1u < m_freeRanges.size()) {
+        const u64 buddy = offset ^ (m_minRangeSize << level);
+        auto      it    = m_freeRanges [level].find(buddy);
+        if (it == m_freeRanges [level].end()) {
+            break;
+        }
+        m_freeRanges [level].erase(it);
+        offset = std::min(offset, buddy);
+        ++level;
+    }
+    m_freeRanges [level].insert(offset);
+}
+
+u64 BuddyAllocator::getRangeSize(u64 size) const {
+    return m_minRangeSize << getLevel(size);
+}
+
+u64 BuddyAllocator::getCapacity() const {
+    return m_size;
+}
+
+u64 BuddyAllocator::getUsedSize() const {
+    return m_usedSize;
+}
+
+u64 BuddyAllocator::getLargestFreeRange() const {
+    for (u32 level = static_cast<u32>(m_freeRanges.size()); level > 0u; --level) {
+        if (!m_freeRanges [level - 1u].empty()) {
+            return m_minRangeSize << (level - 1u);
+        }
+    }
+    return 0u;
+}
+
+bool BuddyAllocator::isEmpty() const {
+    return m_usedSize == 0u;
+}
+
+u32 BuddyAllocator::getLevel(u64 size) const {
+    const u64 rangeSize = std::bit_ceil(std::max(size, m_minRangeSize));
+    return static_cast<u32>(std::countr_zero(rangeSize / m_minRangeSize));
+}
+}   // namespace dnm
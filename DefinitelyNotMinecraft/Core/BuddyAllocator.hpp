@@ -0,0 +1,38 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <vector>
+
+#include <Core/ShortTypes.hpp>
+
+namespace dnm
+{
+// Hands out power of two sized ranges of [0, size). Every range is aligned to its own size,
+// so alignment requirements are met by requesting at least the alignment. Sizes are in whatever
+// unit the owner counts in, e.g. faces for the face pool or bytes for a device memory block.
+class BuddyAllocator {
+    public:
+    BuddyAllocator(u64 size, u64 minRangeSize);
+
+    std::optional<u64> allocate(u64 size);
+    // size has to be the size which was passed to allocate
+    void free(u64 offset, u64 size);
+
+    u64  getRangeSize(u64 size) const;
+    u64  getCapacity() const;
+    u64  getUsedSize() const;
+    u64  getLargestFreeRange() const;
+    bool isEmpty() const;
+
+    private:
+    u32 getLevel(u64 size) const;
+
+    u64 m_size;
+    u64 m_minRangeSize;
+    u64 m_usedSize = 0u;
+
+    // Free range offsets, level 0 holds ranges of m_minRangeSize and every level above doubles the size
+    std::vector<std::set<u64>> m_freeRanges;
+};
+}   // namespace dnm
@@ -11,12 +11,27 @@ struct Config
     bool disableImgui                = false;
     bool limitFrames                 = true;
     bool cullingEnabled              = true;
-    bool updateLight                 = true;
+    bool faceCullingEnabled          = true;
+    bool occlusionCullingEnabled     = true;
+    bool caveCullingEnabled          = true;
+    bool greedyMeshing               = false;
+    bool followCameraPath            = false;
+    // Printed and reset by the render graph
+    bool dumpRenderGraph             = false;
+    // Submits every node on its own, to compare the submission overhead with one submission per queue
+    bool submitPerNode               = false;
+    // Falls back to the graphics queue if the device has no async compute family
+    bool asyncCompute                = true;
+    // Submits the forward pass recorded once per frame in flight and swap chain image again, instead of recording it every frame
+    bool staticForwardPass           = true;
 
+    // Clamped to maxLoadCountChunks, every chunk of the window needs a chunk slot
     u32 loadCountChunks = 4u;
     f32 nearPlane       = 0.01f;
     f32 farPlane        = 250.0f;
     u32 insertionMode   = 0;
+    // Frames the CPU may record ahead of the GPU, clamped to Renderer::maxFramesInFlight
+    u32 framesInFlight  = 2u;
 
     v3 lookingAt;
 
@@ -0,0 +1,46 @@
+#include "Core/JobSystem.hpp"
+
+namespace dnm
+{
+JobSystem::JobSystem(u32 workerCount) {
+    addWorkers(workerCount);
+}
+
+void JobSystem::addWorkers(u32 count) {
+    auto threadLambda = [this](const std::stop_token& stopToken)
+    {
+        while (true) {
+            std::packaged_task<void()> job;
+            {
+                std::unique_lock l {m_mutex};
+                // Idle workers are woken by new jobs instead of polling
+                if (!m_jobAvailable.wait(l, stopToken, [this]() { return !m_jobs.empty(); })) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job();
+        }
+    };
+
+    for (u32 i = 0u; i < count; ++i) {
+        m_workers.emplace_back(threadLambda);
+    }
+}
+
+std::future<void> JobSystem::schedule(std::function<void()> job) {
+    std::packaged_task<void()> task {std::move(job)};
+    auto                       future = task.get_future();
+    {
+        std::lock_guard l {m_mutex};
+        m_jobs.emplace_back(std::move(task));
+    }
+    m_jobAvailable.notify_one();
+    return future;
+}
+
+u32 JobSystem::getWorkerCount() const {
+    return static_cast<u32>(m_workers.size());
+}
+}   // namespace dnm
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Core/ShortTypes.hpp>
+
+namespace dnm
+{
+// Runs jobs on a shared set of worker threads, the returned future rethrows what the job threw
+class JobSystem {
+    public:
+    explicit JobSystem(u32 workerCount = 0u);
+
+    // Every user adds as many workers as it occupies at most, so its jobs never wait for all workers to be busy with another's.
+    // Only called during startup, before any job is scheduled.
+    void addWorkers(u32 count);
+
+    std::future<void> schedule(std::function<void()> job);
+    u32               getWorkerCount() const;
+
+    private:
+    std::mutex                             m_mutex;
+    std::condition_variable_any            m_jobAvailable;
+    std::deque<std::packaged_task<void()>> m_jobs;
+
+    // Workers have to be stopped first on destruction, so keep them at the end
+    std::vector<std::jthread> m_workers;
+};
+}   // namespace dnm
@@ -1,9 +1,26 @@
 #pragma once
 
+#include <string_view>
+
 #include <Core/GLMInclude.hpp>
 #include <Core/ShortTypes.hpp>
 
 namespace dnm
 {
 m4 createProjectionMatrix(const v2& extent, f32 n, f32 f);
+
+// Alignment has to be a power of two, which holds for all Vulkan alignment requirements
+constexpr u64 alignUp(u64 value, u64 alignment) {
+    return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+// FNV-1a, unlike std::hash it is the same across runs and platforms, so it can key files on the disk
+constexpr u64 fnv1aOffsetBasis = 14695981039346656037ull;
+constexpr u64 hashFnv1a(std::string_view data, u64 hash = fnv1aOffsetBasis) {
+    for (const char c : data) {
+        hash ^= static_cast<u8>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
 }   // namespace dnm
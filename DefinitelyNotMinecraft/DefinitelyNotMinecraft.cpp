@@ -2,6 +2,7 @@
 
 #include <Core/Chrono.hpp>
 #include <Core/Config.hpp>
+#include <Core/JobSystem.hpp>
 #include <Core/Profiler.hpp>
 #include <Core/StringInterner.hpp>
 
@@ -14,6 +15,7 @@
 #include <RenderingNodes/BlockRenderingNode.hpp>
 #include <RenderingNodes/ForwardRenderingNode.hpp>
 #include <RenderingNodes/GizmoRenderingNode.hpp>
+#include <RenderingNodes/GreedyMeshingNode.hpp>
 #include <RenderingNodes/ImguiRenderingNode.hpp>
 
 #include <Shader/ShaderManager.hpp>
@@ -21,23 +23,34 @@
 int main(int /*argc*/, char** /*argv*/) {
     using namespace dnm;
     try {
+        // Printed with the state of the pipeline and shader caches, the node constructors compile the shaders and create the pipelines
+        const auto     startupBegin = std::chrono::steady_clock::now();
         Config         config;
         StringInterner interner;
-        ShaderManager  shaderManager {&interner};
+        ShaderManager  shaderManager {&interner, shaderPermutations};
         Renderer       renderer {&config};
         auto*          window = renderer.getGLFWwindow();
-        Camera         camera(&config, &renderer);
+        Camera         camera(&config);
         BlockWorld     world {&config};
         Imgui          imgui(&config, window);
-        RenderGraph    graph {&renderer, &camera};
+        // Shared by the recording lanes of the graph and the greedy meshing, each adds the workers it uses
+        JobSystem      jobSystem;
+        RenderGraph    graph {&config, &renderer, &camera, &jobSystem};
         GizmoData      gizmoData;
         Input          input(&camera, window, &world, &config, &gizmoData);
 
         graph.registerNode(std::make_unique<BlockDrawCallNode>(&config, &renderer, &shaderManager, &world, &interner));
+        // Registers the greedy buffers, so it has to be created before the forward node builds its pipelines
+        graph.registerNode(std::make_unique<GreedyMeshingNode>(&config, &renderer, &world, &jobSystem));
         graph.registerNode(std::make_unique<ForwardRenderingNode>(&config, &renderer, &shaderManager, &world, &interner));
         graph.registerNode(std::make_unique<ImguiRenderingNode>(&config, &renderer));
         graph.registerNode(std::make_unique<GizmoRenderingNode>(&config, &renderer, &shaderManager, &world, &interner, &gizmoData));
 
+        const TimeSpan startupTime = std::chrono::duration_cast<TimeSpan>(std::chrono::steady_clock::now() - startupBegin);
+        const auto     shaderCache = shaderManager.getCacheStatistics();
+        std::cout << "Startup took " << startupTime.count() << " ms with a " << (renderer.isPipelineCacheWarm() ? "warm" : "cold") << " pipeline cache, "
+                  << shaderCache.embedded << " shaders were embedded, " << shaderCache.hits << " cached and " << shaderCache.compilations << " compiled\n";
+
         auto lastFrame = std::chrono::system_clock::now();
 
         while (!glfwWindowShouldClose(window)) {
@@ -1,5 +1,6 @@
 #include "Logic/BlockWorld.hpp"
 
+#include <algorithm>
 #include <thread>
 
 #include <Core/Config.hpp>
@@ -122,6 +123,9 @@ BlockWorld::BlockWorld(Config* config) : m_config {config} {
                     }
                 }
             }
+            for (u64 section = 0u; section < sectionsPerChunk; ++section) {
+                chunkToGenerate.value().connectivity [section] = computeSectionConnectivity(blockData, section);
+            }
             chunkToGenerate.value().finished->store(true);
             chunkToGenerate = {};
         }
@@ -210,7 +214,7 @@ BlockWorld::ChunkState BlockWorld::requestChunk(glm::ivec2 chunkPosition) {
             // more things are inserted
             {
                 std::lock_guard l {m_workInsertionLock};
-                m_chunkPositionsQueue.emplace_back(GenerationData {chunkPosition, chunk.data, &chunk.finished});
+                m_chunkPositionsQueue.emplace_back(GenerationData {chunkPosition, chunk.data, chunk.connectivity, &chunk.finished});
             }
 
             chunk.state = ChunkState::InProgress;
@@ -230,7 +234,7 @@ bool BlockWorld::isRenderingDirty(glm::ivec2 chunkPosition) const {
         return false;
     }
 
-    return it->second.state == ChunkState::RequiresOuterVisibilityUpdate;
+    return it->second.state == ChunkState::RequiresOuterVisibilityUpdate || it->second.state == ChunkState::RequiresFullVisibilityUpdate;
 }
 
 std::span<const BlockType> BlockWorld::getChunkData(glm::ivec2 chunkPosition) const {
@@ -244,6 +248,74 @@ std::span<const BlockType> BlockWorld::getChunkData(glm::ivec2 chunkPosition) co
     return it->second.data;
 }
 
+void BlockWorld::collectVisibleSections(v3 cameraPosition, u32 chunkRadius, std::unordered_map<glm::ivec2, u8>& sectionMasks) const {
+    ZoneScoped;
+    static_assert(sectionsPerChunk <= 8u);
+    sectionMasks.clear();
+
+    const i32        radius     = static_cast<i32>(chunkRadius);
+    const i32        windowSize = 2 * radius + 1;
+    const glm::ivec2 cameraChunk {static_cast<i32>(cameraPosition.x) / static_cast<i32>(chunkLocalSize),
+                                  static_cast<i32>(cameraPosition.z) / static_cast<i32>(chunkLocalSize)};
+    // Above or below the world the fill starts from the closest section
+    const i32 cameraSection = std::clamp(static_cast<i32>(cameraPosition.y) / static_cast<i32>(sectionHeight), 0, static_cast<i32>(sectionsPerChunk) - 1);
+
+    struct Step
+    {
+        glm::ivec3 section;
+        // Face of the section the fill came in through, the camera's section is entered through none
+        u32        entryFace;
+        // Directions the fill went along to reach the section, it never turns back against one of them
+        u32        directions;
+    };
+
+    auto getWindowIndex = [&](glm::ivec3 section)
+    {
+        const glm::ivec2 windowPosition = glm::ivec2(section.x, section.z) - cameraChunk + radius;
+        return (windowPosition.y * windowSize + windowPosition.x) * static_cast<i32>(sectionsPerChunk) + section.y;
+    };
+
+    std::vector<u8>   visited(static_cast<u64>(windowSize) * windowSize * sectionsPerChunk, 0u);
+    std::vector<Step> steps;
+    steps.push_back(Step {glm::ivec3(cameraChunk.x, cameraSection, cameraChunk.y), sectionFaceCount, 0u});
+    visited [getWindowIndex(steps.front().section)] = 1u;
+
+    std::lock_guard g {m_chunkDataMutex};
+    for (u64 i = 0u; i < steps.size(); ++i) {
+        const Step step = steps [i];
+        sectionMasks [glm::ivec2(step.section.x, step.section.z)] |= static_cast<u8>(1u << step.section.y);
+
+        SectionConnectivity connectivity = fullyConnected;
+        const auto          it           = m_chunkData.find(glm::ivec2(step.section.x, step.section.z));
+        // Chunks which are still generated could be open anywhere
+        if (it != m_chunkData.end() && it->second.state != ChunkState::Created && it->second.state != ChunkState::InProgress) {
+            connectivity = it->second.connectivity [step.section.y];
+        }
+
+        for (u32 face = 0u; face < sectionFaceCount; ++face) {
+            if ((step.directions >> oppositeSectionFace [face]) & 1u) {
+                continue;
+            }
+            if (step.entryFace != sectionFaceCount && !areFacesConnected(connectivity, step.entryFace, face)) {
+                continue;
+            }
+
+            const glm::ivec3 neighbor = step.section + sectionFaceDirections [face];
+            if (neighbor.y < 0 || neighbor.y >= static_cast<i32>(sectionsPerChunk) || std::abs(neighbor.x - cameraChunk.x) > radius ||
+                std::abs(neighbor.z - cameraChunk.y) > radius) {
+                continue;
+            }
+
+            auto& neighborVisited = visited [getWindowIndex(neighbor)];
+            if (neighborVisited != 0u) {
+                continue;
+            }
+            neighborVisited = 1u;
+            steps.push_back(Step {neighbor, oppositeSectionFace [face], step.directions | (1u << face)});
+        }
+    }
+}
+
 void BlockWorld::modifyFirstTracedBlock(const std::optional<BlockWorld::BlockPosition>& potentialTarget) {
     const auto action = static_cast<BlockWorld::BlockAction>(m_config->insertionMode);
     switch (action) {
@@ -313,6 +385,9 @@ void BlockWorld::updateBlock(const BlockWorld::BlockPosition& position, BlockTyp
 
     it->second.data [heightOffset + inLayerOffset] = type;
     it->second.state                               = ChunkState::RequiresFullVisibilityUpdate;
+
+    const u64 section                 = position.positionWithinChunk.y / sectionHeight;
+    it->second.connectivity [section] = computeSectionConnectivity(it->second.data, section);
     triggerVisibilityUpdateOnNeighbors(position);
 }
 
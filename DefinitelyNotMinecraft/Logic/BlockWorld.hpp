@@ -11,6 +11,8 @@
 #include <Core/GLMInclude.hpp>
 #include <Core/ShortTypes.hpp>
 
+#include <Logic/SectionConnectivity.hpp>
+
 #include "PerlinNoise.hpp"
 #include "glm/gtx/hash.hpp"
 
@@ -34,8 +36,12 @@ class BlockWorld {
     };
 
     ChunkState                 requestChunk(glm::ivec2 chunkPosition);
+    // True if the data changed since the last time the chunk was requested
     bool                       isRenderingDirty(glm::ivec2 chunkPosition) const;
     std::span<const BlockType> getChunkData(glm::ivec2 chunkPosition) const;
+    // Flood fills the sections around the camera through the connectivity of their faces, sections it can't reach are
+    // enclosed from the camera. Writes one bit per section for every reached chunk of the window.
+    void                       collectVisibleSections(v3 cameraPosition, u32 chunkRadius, std::unordered_map<glm::ivec2, u8>& sectionMasks) const;
 
     enum class BlockAction
     {
@@ -54,10 +60,15 @@ class BlockWorld {
     std::optional<BlockPosition> getFirstTracedBlock(Camera* camera);
     void                         updateBlock(const BlockPosition& position, BlockType type);
 
-    constexpr static u64       chunkLocalSize     = 32u;
-    constexpr static u64       chunkHeight        = 128u;
-    constexpr static u64       perChunkBlockCount = (chunkLocalSize * chunkLocalSize * chunkHeight);
-    constexpr static BlockType air                = BlockType(65535u);
+    constexpr static u64       chunkLocalSize       = 32u;
+    constexpr static u64       chunkHeight          = 128u;
+    constexpr static u64       perChunkBlockCount   = (chunkLocalSize * chunkLocalSize * chunkHeight);
+    // Chunks are split into sections along the height for culling
+    constexpr static u64       sectionHeight        = 16u;
+    constexpr static u64       sectionsPerChunk     = chunkHeight / sectionHeight;
+    constexpr static u64       perSectionBlockCount = (chunkLocalSize * chunkLocalSize * sectionHeight);
+    constexpr static u64       faceDirectionCount   = 6u;
+    constexpr static BlockType air                  = BlockType(65535u);
 
     private:
     Config* m_config;
@@ -70,6 +81,7 @@ class BlockWorld {
     {
         glm::ivec2                                                          position;
         std::span<BlockType, chunkLocalSize * chunkLocalSize * chunkHeight> data;
+        std::span<SectionConnectivity, sectionsPerChunk>                    connectivity;
         std::atomic<bool>*                                                  finished;
     };
 
@@ -78,6 +90,8 @@ class BlockWorld {
     struct Chunk
     {
         std::array<BlockType, chunkLocalSize * chunkLocalSize * chunkHeight> data;
+        // Written by the generation thread before it finishes the chunk, afterwards only with the data
+        std::array<SectionConnectivity, sectionsPerChunk>                    connectivity {};
         std::atomic<bool>                                                    finished;
         ChunkState                                                           state = ChunkState::Created;
     };
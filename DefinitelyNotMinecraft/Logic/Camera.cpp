@@ -1,22 +1,11 @@
 #include "Logic/Camera.hpp"
 
 #include <Core/Formatter.hpp>
+#include <Core/Profiler.hpp>
 
 namespace dnm
 {
-namespace
-{
-    struct BufferContent
-    {
-        m4 viewMatrix;
-        v4 cameraPosition;
-    };
-}   // namespace
-
-Camera::Camera(Config* config, Renderer* renderer) : m_config {config} {
-    m_viewBuffer             = renderer->createBuffer(sizeof(BufferContent), vk::BufferUsageFlagBits::eUniformBuffer, "View Matrix");
-    m_viewBufferRegistration = renderer->registerRAIIBuffer(GlobalBuffers::CameraView, m_viewBuffer);
-
+Camera::Camera(Config* config) : m_config {config} {
     updateViewMatrix();
 }
 
@@ -51,6 +40,11 @@ void Camera::processMouseMovement(float xoffset, float yoffset) {
 
 bool Camera::update(TimeSpan deltaTime) {
     ZoneScoped;
+    if (m_config->followCameraPath) {
+        followPath(deltaTime);
+        return true;
+    }
+
     if (!m_dirty) {
         return false;
     }
@@ -76,12 +70,6 @@ bool Camera::update(TimeSpan deltaTime) {
 
     updateViewMatrix();
 
-    BufferContent content;
-    content.viewMatrix     = m_viewMatrix;
-    content.cameraPosition = v4(m_position, 1.0f);
-
-    copyToDevice(m_viewBuffer.deviceMemory, std::span<const BufferContent>(&content, 1u));
-
     m_dirty              = false;
     m_accumulatedXChange = 0.0f;
     m_accumulatedYChange = 0.0f;
@@ -114,6 +102,35 @@ m4 Camera::getViewMatrix() const {
     return m_viewMatrix;
 }
 
+Camera::ViewData Camera::getViewData() const {
+    return ViewData {m_viewMatrix, v4(m_position, 1.0f)};
+}
+
+void Camera::followPath(TimeSpan deltaTime) {
+    // Orbits the spawn point at a fixed speed, so measurements of different renderers see the same frames
+    constexpr v3    pathCenter {500.0f, 140.0f, 500.0f};
+    constexpr float pathRadius   = 200.0f;
+    constexpr float pathDuration = 60000.0f;
+    constexpr float pathPitch    = -15.0f;
+
+    m_pathTime        = std::fmod(m_pathTime + deltaTime.count(), pathDuration);
+    const float angle = glm::two_pi<float>() * m_pathTime / pathDuration;
+
+    m_position = pathCenter + v3(std::cos(angle), 0.0f, std::sin(angle)) * pathRadius;
+    // Facing along the orbit, the camera looks down -z without rotation
+    m_rotation = v3(pathPitch, glm::degrees(glm::pi<float>() - angle), 0.0f);
+
+    updateViewMatrix();
+
+    m_dirty              = false;
+    m_accumulatedXChange = 0.0f;
+    m_accumulatedYChange = 0.0f;
+
+    m_forward = 0.0f;
+    m_side    = 0.0f;
+    m_up      = 0.0f;
+}
+
 void Camera::updateViewMatrix() {
     m_cameraTransform = mat4_cast(glm::quat(v3(glm::radians(m_rotation.x), glm::radians(m_rotation.y), glm::radians(m_rotation.z))));
 
@@ -4,7 +4,7 @@
 #include <Core/Config.hpp>
 #include <Core/GLMInclude.hpp>
 
-#include <Rendering/Renderer.hpp>
+#include <Core/ShortTypes.hpp>
 
 namespace dnm
 {
@@ -20,7 +20,14 @@ class Camera {
         DOWN
     };
 
-    explicit Camera(Config* config, Renderer* renderer);
+    // Layout of the viewBuffer uniform in CameraBuffer.glsl
+    struct ViewData
+    {
+        m4 viewMatrix;
+        v4 cameraPosition;
+    };
+
+    explicit Camera(Config* config);
 
     void processKeyboard(CameraMovement direction, TimeSpan deltaTime);
 
@@ -34,8 +41,11 @@ class Camera {
     v3 getPosition() const;
     m4 getViewMatrix() const;
 
+    ViewData getViewData() const;
+
     private:
     void updateViewMatrix();
+    void followPath(TimeSpan deltaTime);
 
     private:
     Config* m_config;
@@ -53,8 +63,7 @@ class Camera {
     float m_forward            = 0.0f;
     float m_side               = 0.0f;
     float m_up                 = 0.0f;
-
-    BufferData                          m_viewBuffer {nullptr};
-    std::unique_ptr<BufferRegistration> m_viewBufferRegistration {nullptr};
+    // Milliseconds into the fixed camera path
+    float m_pathTime = 0.0f;
 };
 }   // namespace dnm
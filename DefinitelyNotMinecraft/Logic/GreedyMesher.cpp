@@ -0,0 +1,177 @@
+#include "Logic/GreedyMesher.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+#include <Core/Profiler.hpp>
+
+namespace dnm
+{
+namespace
+{
+    constexpr u32       directionCount       = 6u;
+    constexpr u32       visibilityBitsOffset = sizeof(BlockType) * 8u - directionCount;
+    constexpr BlockType blockTypeMask        = BlockType((1u << visibilityBitsOffset) - 1u);
+    constexpr u32       emptyCell            = ~0u;
+
+    // Axes with x = 0, y = 1 and z = 2 of every face direction, the texture axes have to match Shaders/FaceGeometry.glsl
+    constexpr std::array<u32, directionCount> normalAxis {0u, 2u, 1u, 1u, 0u, 2u};
+    constexpr std::array<u32, directionCount> uAxis {2u, 0u, 0u, 0u, 2u, 0u};
+    constexpr std::array<u32, directionCount> vAxis {1u, 1u, 2u, 2u, 1u, 1u};
+
+    constexpr glm::uvec3 chunkExtent {BlockWorld::chunkLocalSize, BlockWorld::chunkHeight, BlockWorld::chunkLocalSize};
+
+    u64 toIndex(glm::uvec3 position) {
+        return position.y * BlockWorld::chunkLocalSize * BlockWorld::chunkLocalSize + position.z * BlockWorld::chunkLocalSize + position.x;
+    }
+
+    // Same layout as packFace in Shaders/PackedFace.glsl, the chunk slot is added once the mesh is placed
+    u32 packFace(glm::uvec3 position, u32 direction, u32 blockType) {
+        return position.x | (position.z << 5u) | (position.y << 10u) | (direction << 17u) | ((blockType & 15u) << 20u);
+    }
+}   // namespace
+
+GreedyMesher::GreedyMesher(JobSystem* jobSystem, u32 maxConcurrentJobs) : m_jobSystem {jobSystem}, m_maxConcurrentJobs {maxConcurrentJobs} {
+    m_jobSystem->addWorkers(m_maxConcurrentJobs);
+}
+
+GreedyMesher::~GreedyMesher() {
+    {
+        // Queued chunks are dropped, only the ones being meshed are finished
+        std::lock_guard l {m_mutex};
+        m_jobs.clear();
+    }
+    for (auto& drain : m_drains) {
+        drain.wait();
+    }
+}
+
+void GreedyMesher::drainJobs() {
+    while (true) {
+        std::optional<Job> job;
+        {
+            std::lock_guard l {m_mutex};
+            if (m_jobs.empty()) {
+                --m_drainCount;
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_inProgressCount;
+        }
+
+        Mesh result = mesh(job->chunk, job->version, job->blocks);
+
+        std::lock_guard l {m_mutex};
+        m_finished.emplace_back(std::move(result));
+        --m_inProgressCount;
+    }
+}
+
+void GreedyMesher::request(glm::ivec2 chunk, u32 version, std::span<const BlockType> blocks) {
+    ZoneScoped;
+    std::lock_guard l {m_mutex};
+
+    // A queued job of the same chunk is outdated, so it is replaced instead of meshing the chunk twice
+    for (auto& job : m_jobs) {
+        if (job.chunk == chunk) {
+            job.version = version;
+            job.blocks.assign(blocks.begin(), blocks.end());
+            return;
+        }
+    }
+    m_jobs.emplace_back(Job {chunk, version, std::vector<BlockType>(blocks.begin(), blocks.end())});
+
+    // A running drain picks the job up, so new drains are only needed while fewer than the limit run
+    if (m_drainCount < m_maxConcurrentJobs) {
+        ++m_drainCount;
+        std::erase_if(m_drains, [](const std::future<void>& drain) { return drain.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        m_drains.emplace_back(m_jobSystem->schedule([this]() { drainJobs(); }));
+    }
+}
+
+void GreedyMesher::collectFinished(std::vector<Mesh>& meshes) {
+    std::lock_guard l {m_mutex};
+    meshes.insert(meshes.end(), std::make_move_iterator(m_finished.begin()), std::make_move_iterator(m_finished.end()));
+    m_finished.clear();
+}
+
+u32 GreedyMesher::getPendingCount() const {
+    std::lock_guard l {m_mutex};
+    return static_cast<u32>(m_jobs.size()) + m_inProgressCount;
+}
+
+GreedyMesher::Mesh GreedyMesher::mesh(glm::ivec2 chunk, u32 version, std::span<const BlockType> blocks) {
+    ZoneScoped;
+    assert(blocks.size() == BlockWorld::perChunkBlockCount);
+
+    Mesh result {chunk, version, {}};
+
+    // Block type of every exposed face in the current slice, indexed by v * sizeU + u
+    std::vector<u32> mask;
+    for (u32 direction = 0u; direction < directionCount; ++direction) {
+        const u32       n          = normalAxis [direction];
+        const u32       u          = uAxis [direction];
+        const u32       v          = vAxis [direction];
+        const u32       sizeU      = chunkExtent [u];
+        const u32       sizeV      = chunkExtent [v];
+        const BlockType visibleBit = BlockType(1u << (visibilityBitsOffset + direction));
+
+        mask.resize(sizeU * sizeV);
+        for (u32 slice = 0u; slice < chunkExtent [n]; ++slice) {
+            glm::uvec3 position {};
+            position [n] = slice;
+
+            for (u32 pv = 0u; pv < sizeV; ++pv) {
+                for (u32 pu = 0u; pu < sizeU; ++pu) {
+                    position [u]            = pu;
+                    position [v]            = pv;
+                    const BlockType block   = blocks [toIndex(position)];
+                    const bool      exposed = block != BlockWorld::air && (block & visibleBit) != 0u;
+                    mask [pv * sizeU + pu]  = exposed ? (block & blockTypeMask) : emptyCell;
+                    result.faceCount += exposed ? 1u : 0u;
+                }
+            }
+
+            for (u32 pv = 0u; pv < sizeV; ++pv) {
+                for (u32 pu = 0u; pu < sizeU;) {
+                    const u32 blockType = mask [pv * sizeU + pu];
+                    if (blockType == emptyCell) {
+                        ++pu;
+                        continue;
+                    }
+
+                    u32 width = 1u;
+                    while (pu + width < sizeU && mask [pv * sizeU + pu + width] == blockType) {
+                        ++width;
+                    }
+
+                    // Grow the quad row by row as long as the whole row matches
+                    u32 height = 1u;
+                    while (pv + height < sizeV) {
+                        const auto rowBegin = mask.begin() + (pv + height) * sizeU + pu;
+                        if (!std::all_of(rowBegin, rowBegin + width, [blockType](u32 cell) { return cell == blockType; })) {
+                            break;
+                        }
+                        ++height;
+                    }
+
+                    for (u32 row = 0u; row < height; ++row) {
+                        const auto rowBegin = mask.begin() + (pv + row) * sizeU + pu;
+                        std::fill(rowBegin, rowBegin + width, emptyCell);
+                    }
+
+                    position [u] = pu;
+                    position [v] = pv;
+                    result.quads.emplace_back(GreedyQuad {packFace(position, direction, blockType), (width - 1u) | ((height - 1u) << 5u)});
+
+                    pu += width;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+}   // namespace dnm
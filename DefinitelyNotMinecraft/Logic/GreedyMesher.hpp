@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <Core/JobSystem.hpp>
+
+#include <Logic/BlockWorld.hpp>
+
+namespace dnm
+{
+// Layout of the GreedyQuad struct in Shaders/GreedyWorld.vert
+struct GreedyQuad
+{
+    // Minimum block of the quad, packed like Shaders/PackedFace.glsl
+    u32 face;
+    // (width - 1) | (height - 1) << 5 along the texture axes of the face direction
+    u32 size;
+};
+
+// Merges coplanar exposed faces of the same block type into larger quads on the workers of the job system
+class GreedyMesher {
+    public:
+    GreedyMesher(JobSystem* jobSystem, u32 maxConcurrentJobs);
+    ~GreedyMesher();
+
+    struct Mesh
+    {
+        glm::ivec2              chunk;
+        u32                     version;
+        std::vector<GreedyQuad> quads;
+        // Faces drawing the chunk one quad per face would take
+        u32                     faceCount = 0u;
+    };
+
+    // The blocks are copied, so the chunk can change while it is meshed
+    void request(glm::ivec2 chunk, u32 version, std::span<const BlockType> blocks);
+    void collectFinished(std::vector<Mesh>& meshes);
+    u32  getPendingCount() const;
+
+    static Mesh mesh(glm::ivec2 chunk, u32 version, std::span<const BlockType> blocks);
+
+    private:
+    struct Job
+    {
+        glm::ivec2             chunk;
+        u32                    version;
+        std::vector<BlockType> blocks;
+    };
+
+    // Scheduled on the job system, meshes queued chunks until there are none left
+    void drainJobs();
+
+    JobSystem* m_jobSystem;
+    u32        m_maxConcurrentJobs;
+
+    mutable std::mutex             m_mutex;
+    std::deque<Job>                m_jobs;
+    std::vector<Mesh>              m_finished;
+    u32                            m_inProgressCount = 0u;
+    u32                            m_drainCount      = 0u;
+    std::vector<std::future<void>> m_drains;
+};
+}   // namespace dnm
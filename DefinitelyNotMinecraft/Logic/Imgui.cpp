@@ -6,6 +6,8 @@
 
 #include <Logic/Camera.hpp>
 
+#include <Rendering/Renderer.hpp>
+
 namespace dnm
 {
 Imgui::Imgui(Config* config, GLFWwindow* window) : m_config {config} {
@@ -45,12 +47,36 @@ void Imgui::logicFrame(TimeSpan dt, const Camera* camera) const {
 
         ImGui::Text("Modification mode %d", m_config->insertionMode);
 
-        ImGui::Checkbox("Generate draw calls every frame", &m_config->everyFrameGenerateDrawCalls);
+        ImGui::Checkbox("Regenerate chunk faces every frame", &m_config->everyFrameGenerateDrawCalls);
 
         ImGui::Checkbox("Culling enabled", &m_config->cullingEnabled);
 
+        ImGui::Checkbox("Cull faces pointing away from the camera", &m_config->faceCullingEnabled);
+
+        ImGui::Checkbox("Cull sections hidden behind the depth pyramid", &m_config->occlusionCullingEnabled);
+
+        ImGui::Checkbox("Cull sections enclosed from the camera (CPU flood fill)", &m_config->caveCullingEnabled);
+
+        ImGui::Checkbox("Greedy meshing (CPU)", &m_config->greedyMeshing);
+
+        ImGui::Checkbox("Follow fixed camera path", &m_config->followCameraPath);
+
         ImGui::Checkbox("Limit frames", &m_config->limitFrames);
 
+        constexpr u32 minFramesInFlight = 1u;
+        constexpr u32 maxFramesInFlight = Renderer::maxFramesInFlight;
+        ImGui::SliderScalar("Frames in flight", ImGuiDataType_U32, &m_config->framesInFlight, &minFramesInFlight, &maxFramesInFlight);
+
+        ImGui::Checkbox("Submit every render graph node on its own", &m_config->submitPerNode);
+
+        ImGui::Checkbox("Generate draw calls on the async compute queue", &m_config->asyncCompute);
+
+        ImGui::Checkbox("Reuse the recorded forward pass", &m_config->staticForwardPass);
+
+        if (ImGui::Button("Dump render graph")) {
+            m_config->dumpRenderGraph = true;
+        }
+
         ImGui::InputFloat3("Looking at", &m_config->lookingAt.x);
 
         ImGui::BeginGroup();
@@ -67,8 +93,6 @@ void Imgui::logicFrame(TimeSpan dt, const Camera* camera) const {
         ImGui::InputFloat3("Light Color3", &m_config->lightColor3.x);
         ImGui::InputFloat3("Light Pos3", &m_config->lightPosition3.x);
 
-        ImGui::Checkbox("Update Light Buffer", &m_config->updateLight);
-
         ImGui::EndGroup();
 
         ImGui::End();
@@ -0,0 +1,91 @@
+#include "Logic/SectionConnectivity.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <Core/Profiler.hpp>
+
+#include <Logic/BlockWorld.hpp>
+
+namespace dnm
+{
+namespace
+{
+    constexpr i32 sectionSize   = static_cast<i32>(BlockWorld::chunkLocalSize);
+    constexpr i32 sectionHeight = static_cast<i32>(BlockWorld::sectionHeight);
+    constexpr i32 layerSize     = sectionSize * sectionSize;
+
+    glm::ivec3 getBlockPosition(i32 index) {
+        return {index % sectionSize, index / layerSize, (index % layerSize) / sectionSize};
+    }
+
+    // Bit per face of the section the block lies on
+    u32 getTouchedFaces(glm::ivec3 position) {
+        u32 faces = 0u;
+        faces |= static_cast<u32>(position.x == 0) << 0u;
+        faces |= static_cast<u32>(position.z == sectionSize - 1) << 1u;
+        faces |= static_cast<u32>(position.y == sectionHeight - 1) << 2u;
+        faces |= static_cast<u32>(position.y == 0) << 3u;
+        faces |= static_cast<u32>(position.x == sectionSize - 1) << 4u;
+        faces |= static_cast<u32>(position.z == 0) << 5u;
+        return faces;
+    }
+}   // namespace
+
+SectionConnectivity computeSectionConnectivity(std::span<const BlockType> chunkBlocks, u64 section) {
+    ZoneScoped;
+    const auto blocks = chunkBlocks.subspan(section * BlockWorld::perSectionBlockCount, BlockWorld::perSectionBlockCount);
+
+    const auto airCount = std::ranges::count(blocks, BlockWorld::air);
+    if (airCount == 0) {
+        return 0u;
+    }
+    if (airCount == static_cast<i64>(blocks.size())) {
+        return fullyConnected;
+    }
+
+    std::vector<u8>  visited(blocks.size(), 0u);
+    std::vector<i32> stack;
+
+    SectionConnectivity connectivity = 0u;
+    for (i32 seed = 0; seed < static_cast<i32>(blocks.size()) && connectivity != fullyConnected; ++seed) {
+        // Air which doesn't touch the border can't connect any faces
+        if (blocks [seed] != BlockWorld::air || visited [seed] != 0u || getTouchedFaces(getBlockPosition(seed)) == 0u) {
+            continue;
+        }
+
+        u32 faces      = 0u;
+        visited [seed] = 1u;
+        stack.push_back(seed);
+        while (!stack.empty()) {
+            const glm::ivec3 position = getBlockPosition(stack.back());
+            stack.pop_back();
+            faces |= getTouchedFaces(position);
+
+            for (const auto& direction : sectionFaceDirections) {
+                const glm::ivec3 neighbor = position + direction;
+                if (neighbor.x < 0 || neighbor.x >= sectionSize || neighbor.y < 0 || neighbor.y >= sectionHeight || neighbor.z < 0 ||
+                    neighbor.z >= sectionSize) {
+                    continue;
+                }
+
+                const i32 index = neighbor.y * layerSize + neighbor.z * sectionSize + neighbor.x;
+                if (blocks [index] != BlockWorld::air || visited [index] != 0u) {
+                    continue;
+                }
+                visited [index] = 1u;
+                stack.push_back(index);
+            }
+        }
+
+        for (u32 first = 0u; first < sectionFaceCount; ++first) {
+            for (u32 second = first + 1u; second < sectionFaceCount; ++second) {
+                if (((faces >> first) & (faces >> second) & 1u) != 0u) {
+                    connectivity |= SectionConnectivity(1u << getFacePairIndex(first, second));
+                }
+            }
+        }
+    }
+    return connectivity;
+}
+}   // namespace dnm
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <span>
+
+#include <Core/GLMInclude.hpp>
+#include <Core/ShortTypes.hpp>
+
+namespace dnm
+{
+using BlockType = u16;
+
+// One bit per pair of section faces which are connected through air, a section can only be seen through from one
+// face to the other if they are
+using SectionConnectivity = u16;
+
+constexpr u32                 sectionFaceCount = 6u;
+constexpr SectionConnectivity fullyConnected   = SectionConnectivity((1u << (sectionFaceCount * (sectionFaceCount - 1u) / 2u)) - 1u);
+
+// Same order as the visibility bits of the blocks, y steps from one section of a chunk to the next
+constexpr std::array<glm::ivec3, sectionFaceCount> sectionFaceDirections {
+  glm::ivec3 {-1,  0,  0},
+  glm::ivec3 { 0,  0,  1},
+  glm::ivec3 { 0,  1,  0},
+  glm::ivec3 { 0, -1,  0},
+  glm::ivec3 { 1,  0,  0},
+  glm::ivec3 { 0,  0, -1}
+};
+constexpr std::array<u32, sectionFaceCount> oppositeSectionFace {4u, 5u, 3u, 2u, 0u, 1u};
+
+constexpr u32 getFacePairIndex(u32 first, u32 second) {
+    const u32 low  = first < second ? first : second;
+    const u32 high = first < second ? second : first;
+    return low * (2u * sectionFaceCount - low - 1u) / 2u + high - low - 1u;
+}
+
+constexpr bool areFacesConnected(SectionConnectivity connectivity, u32 first, u32 second) {
+    return first != second && ((connectivity >> getFacePairIndex(first, second)) & 1u) != 0u;
+}
+
+// Flood fills the air of one section of a chunk from its border
+SectionConnectivity computeSectionConnectivity(std::span<const BlockType> chunkBlocks, u64 section);
+}   // namespace dnm
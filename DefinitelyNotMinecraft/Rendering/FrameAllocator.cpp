@@ -0,0 +1,64 @@
+#include "Rendering/FrameAllocator.hpp"
+
+#include <Core/Math.hpp>
+#include <Core/Profiler.hpp>
+
+namespace dnm
+{
+FrameAllocator::FrameAllocator(DeviceMemoryAllocator& allocator, vk::DeviceSize regionSize, u32 regionCount, std::span<const u32> sharingFamilies) :
+    m_regionCount {regionCount} {
+    const auto& limits = allocator.getPhysicalDevice().getProperties().limits;
+    m_alignment        = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+    m_regionSize       = alignUp(regionSize, m_alignment);
+
+    m_buffer = BufferData(
+      allocator,
+      m_regionSize * regionCount,
+      vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer |
+        vk::BufferUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+      sharingFamilies);
+    registerDebugMarker(allocator.getDevice(), m_buffer.buffer, "Frame Allocator");
+}
+
+void FrameAllocator::beginFrame(u32 frameIndex) {
+    assert(frameIndex < m_regionCount);
+    TracyPlot("Frame Allocator Bytes", static_cast<i64>(m_head - m_regionBegin));
+
+    m_regionBegin = frameIndex * m_regionSize;
+    m_head        = m_regionBegin + m_reservedSize;
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(vk::DeviceSize size) {
+    const vk::DeviceSize offset = alignUp(m_head, m_alignment);
+    if (offset + size > m_regionBegin + m_regionSize) {
+        throw std::runtime_error("Frame allocator region exhausted -> increase the region size");
+    }
+    m_head = offset + size;
+
+    return Allocation {checked_cast<u32>(offset), m_buffer.getMapped() + offset};
+}
+
+FrameAllocator::Reservation FrameAllocator::reserve(vk::DeviceSize size) {
+    assert(m_head == m_regionBegin + m_reservedSize);
+    const Reservation reservation {m_reservedSize};
+    if (reservation.offset + size > m_regionSize) {
+        throw std::runtime_error("Frame allocator region exhausted -> increase the region size");
+    }
+
+    // Keeps the allocations behind the reservations aligned
+    m_reservedSize = alignUp(reservation.offset + size, m_alignment);
+    m_head         = m_regionBegin + m_reservedSize;
+    return reservation;
+}
+
+FrameAllocator::Allocation FrameAllocator::getReserved(Reservation reservation, u32 frameIndex) const {
+    assert(frameIndex < m_regionCount && reservation.offset < m_reservedSize);
+    const vk::DeviceSize offset = frameIndex * m_regionSize + reservation.offset;
+    return Allocation {checked_cast<u32>(offset), m_buffer.getMapped() + offset};
+}
+
+const BufferData& FrameAllocator::getBuffer() const {
+    return m_buffer;
+}
+}   // namespace dnm
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <span>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <Core/ShortTypes.hpp>
+
+#include <Rendering/RAIIUtils.hpp>
+
+namespace dnm
+{
+// Linear allocator for data which only lives for one frame. The backing buffer is split into one region per
+// frame in flight, a region is handed out again once the fence of the frame which used it was waited on.
+// Offsets are aligned for uniform and storage descriptors, so they can be used as dynamic offsets directly.
+class FrameAllocator {
+    public:
+    FrameAllocator(DeviceMemoryAllocator& allocator, vk::DeviceSize regionSize, u32 regionCount, std::span<const u32> sharingFamilies);
+
+    void beginFrame(u32 frameIndex);
+
+    struct Allocation
+    {
+        u32        offset;
+        std::byte* memory;
+    };
+
+    Allocation allocate(vk::DeviceSize size);
+
+    template<typename T>
+    u32 push(std::span<const T> data) {
+        const Allocation allocation = allocate(data.size_bytes());
+        memcpy(allocation.memory, data.data(), data.size_bytes());
+        return allocation.offset;
+    }
+
+    template<typename T>
+    u32 push(const T& value) {
+        return push(std::span<const T>(&value, 1u));
+    }
+
+    // Range at the same place of every region, for data which command buffers recorded once keep pointing at.
+    // Has to be reserved before anything is allocated in the current frame.
+    struct Reservation
+    {
+        vk::DeviceSize offset = 0u;
+    };
+
+    Reservation reserve(vk::DeviceSize size);
+    Allocation  getReserved(Reservation reservation, u32 frameIndex) const;
+
+    template<typename T>
+    u32 write(Reservation reservation, u32 frameIndex, std::span<const T> data) {
+        const Allocation allocation = getReserved(reservation, frameIndex);
+        memcpy(allocation.memory, data.data(), data.size_bytes());
+        return allocation.offset;
+    }
+
+    template<typename T>
+    u32 write(Reservation reservation, u32 frameIndex, const T& value) {
+        return write(reservation, frameIndex, std::span<const T>(&value, 1u));
+    }
+
+    const BufferData& getBuffer() const;
+
+    private:
+    BufferData     m_buffer {nullptr};
+    vk::DeviceSize m_alignment;
+    vk::DeviceSize m_regionSize;
+    u32            m_regionCount;
+
+    vk::DeviceSize m_reservedSize = 0u;
+    vk::DeviceSize m_regionBegin  = 0u;
+    vk::DeviceSize m_head         = 0u;
+};
+}   // namespace dnm
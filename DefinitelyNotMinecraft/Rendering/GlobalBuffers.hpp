@@ -7,16 +7,67 @@ namespace dnm
 enum class GlobalBuffers : u8
 {
     ProjectionClip,
-    CameraView,
-    Transform,
-    BlockType,
+    ChunkOrigin,
+    Face,
     DrawCommand,
+    DrawCount,
+    GreedyChunkOrigin,
+    GreedyQuad,
+    GreedyDrawCommand,
+    GreedyDrawCount,
+    DepthPyramid,
+    OcclusionCandidate,
+    OcclusionCandidateDraw,
+    OcclusionCount,
     Undefined
 };
 
 constexpr std::string_view projectionBufferBindingPoint = "projectionBuffer";
 constexpr std::string_view viewBufferBindingPoint       = "viewBuffer";
-constexpr std::string_view transformBindingPoint        = "transformBuffer";
-constexpr std::string_view blockTypeBindingPoint        = "blockTypeBuffer";
+constexpr std::string_view chunkOriginBindingPoint      = "chunkOriginBuffer";
+constexpr std::string_view faceBindingPoint             = "faceBuffer";
 constexpr std::string_view drawCommandBindingPoint      = "drawCallBuffer";
+constexpr std::string_view drawCountBindingPoint        = "drawCountBuffer";
+constexpr std::string_view quadBindingPoint             = "quadBuffer";
+constexpr std::string_view depthPyramidBindingPoint     = "depthPyramidBuffer";
+constexpr std::string_view candidateBindingPoint        = "occlusionCandidateBuffer";
+constexpr std::string_view candidateDrawBindingPoint    = "candidateDrawBuffer";
+constexpr std::string_view occlusionCountBindingPoint   = "occlusionCountBuffer";
+
+// Packed faces address their chunk with the bits above the position, direction and block type, see Shaders/PackedFace.glsl.
+// The shaders get the width as CHUNK_SLOT_BITS through Shader/ShaderPermutations.hpp.
+constexpr u32 chunkSlotShift = 24u;
+constexpr u32 chunkSlotBits  = 8u;
+constexpr u32 maxChunkSlots  = 256u;
+static_assert(chunkSlotShift + chunkSlotBits <= 32u, "The chunk slot has to fit into the packed face");
+static_assert(maxChunkSlots == 1u << chunkSlotBits, "Every chunk slot has to be addressable by a packed face");
+
+// Widest window around the camera chunk whose chunks all get a slot
+constexpr u32 maxLoadCountChunks = []()
+{
+    u32 loadCount = 0u;
+    while ((3u + loadCount * 2u) * (3u + loadCount * 2u) <= maxChunkSlots) {
+        ++loadCount;
+    }
+    return loadCount;
+}();
+// One draw command per face direction of every chunk section, see BlockWorld::sectionsPerChunk
+constexpr u32 maxSectionDrawCount = maxChunkSlots * 8u * 6u;
+// Sections hidden behind an earlier frame's depth are tested again against the depth of the current frame
+constexpr u32 maxOcclusionCandidateCount = maxChunkSlots * 8u;
+constexpr u32 occlusionCullingGroupSize  = 64u;
+
+// Layout of the occlusionCountBuffer in Shaders/OcclusionBuffer.glsl, starts with the indirect dispatch of the late culling
+struct OcclusionCounters
+{
+    u32 candidateGroupCountX = 0u;
+    u32 candidateGroupCountY = 1u;
+    u32 candidateGroupCountZ = 1u;
+    u32 candidateCount       = 0u;
+    u32 candidateDrawCount   = 0u;
+    u32 testedSections       = 0u;
+    u32 lateDrawCount        = 0u;
+    u32 lateVisibleSections  = 0u;
+    u32 lateVisibleFaces     = 0u;
+};
 }   // namespace dnm
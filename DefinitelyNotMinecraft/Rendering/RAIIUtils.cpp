@@ -1,19 +1,174 @@
 #include "Rendering/RAIIUtils.hpp"
 
+#include <bit>
+
 #include <Rendering/Renderer.hpp>
 
 #include <Shader/ShaderManager.hpp>
 
 namespace dnm
 {
-vk::raii::DeviceMemory allocateDeviceMemory(
-  const vk::raii::Device&                   device,
-  const vk::PhysicalDeviceMemoryProperties& memoryProperties,
-  const vk::MemoryRequirements&             memoryRequirements,
-  vk::MemoryPropertyFlags                   memoryPropertyFlags) {
-    const u32                    memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, memoryPropertyFlags);
-    const vk::MemoryAllocateInfo memoryAllocateInfo(memoryRequirements.size, memoryTypeIndex);
-    return vk::raii::DeviceMemory(device, memoryAllocateInfo);
+namespace
+{
+    constexpr vk::DeviceSize defaultMemoryBlockSize = 64u * 1024u * 1024u;
+    constexpr vk::DeviceSize minMemoryRangeSize     = 256u;
+}   // namespace
+
+void MemoryAllocation::release() {
+    if (m_allocator) {
+        m_allocator->free(*this);
+        m_allocator = nullptr;
+    }
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, u32 framesInFlight) :
+    m_physicalDevice {&physicalDevice}, m_device {&device}, m_memoryProperties {physicalDevice.getMemoryProperties()}, m_deferredFrees(framesInFlight) {}
+
+MemoryAllocation DeviceMemoryAllocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags propertyFlags, bool optimalTiling) {
+    ZoneScoped;
+    std::lock_guard guard(m_mutex);
+    const u32            memoryTypeIndex = findMemoryType(m_memoryProperties, requirements.memoryTypeBits, propertyFlags);
+    const vk::DeviceSize blockSize       = getBlockSize(memoryTypeIndex);
+    // Buddy ranges are aligned to their own size, so reserving at least the alignment satisfies it
+    const vk::DeviceSize rangeSize = std::max(requirements.size, requirements.alignment);
+
+    ++m_allocationCount;
+    m_requestedBytes += requirements.size;
+
+    if (rangeSize > blockSize / 2u) {
+        const u32 blockIndex = createBlock(memoryTypeIndex, requirements.size, optimalTiling, true);
+        return makeAllocation(blockIndex, 0u, requirements.size, requirements.size);
+    }
+
+    for (u32 i = 0u; i < m_blocks.size(); ++i) {
+        Block* block = m_blocks [i].get();
+        if (!block || !block->ranges || block->memoryTypeIndex != memoryTypeIndex || block->optimalTiling != optimalTiling) {
+            continue;
+        }
+        if (const auto offset = block->ranges->allocate(rangeSize)) {
+            return makeAllocation(i, *offset, block->ranges->getRangeSize(rangeSize), requirements.size);
+        }
+    }
+
+    const u32  blockIndex = createBlock(memoryTypeIndex, blockSize, optimalTiling, false);
+    const auto offset     = m_blocks [blockIndex]->ranges->allocate(rangeSize);
+    assert(offset);
+    return makeAllocation(blockIndex, *offset, m_blocks [blockIndex]->ranges->getRangeSize(rangeSize), requirements.size);
+}
+
+const vk::raii::PhysicalDevice& DeviceMemoryAllocator::getPhysicalDevice() const {
+    return *m_physicalDevice;
+}
+
+const vk::raii::Device& DeviceMemoryAllocator::getDevice() const {
+    return *m_device;
+}
+
+DeviceMemoryAllocator::Stats DeviceMemoryAllocator::getStats() const {
+    std::lock_guard guard(m_mutex);
+    Stats           stats;
+    stats.allocationCount = m_allocationCount;
+    stats.requestedBytes  = m_requestedBytes;
+    for (const auto& block : m_blocks) {
+        if (!block) {
+            continue;
+        }
+        stats.reservedBytes += block->size;
+        if (block->ranges) {
+            ++stats.blockCount;
+            stats.usedBytes += block->ranges->getUsedSize();
+            stats.largestFreeRange = std::max(stats.largestFreeRange, block->ranges->getLargestFreeRange());
+        }
+        else {
+            ++stats.dedicatedCount;
+            stats.usedBytes += block->size;
+        }
+    }
+    return stats;
+}
+
+void DeviceMemoryAllocator::plotStats() const {
+    const Stats stats = getStats();
+    TracyPlot("Device Memory Blocks", static_cast<int64_t>(stats.blockCount + stats.dedicatedCount));
+    TracyPlot("Device Memory Allocations", static_cast<int64_t>(stats.allocationCount));
+    TracyPlot("Device Memory Reserved Bytes", static_cast<int64_t>(stats.reservedBytes));
+    TracyPlot("Device Memory Used Bytes", static_cast<int64_t>(stats.usedBytes));
+    // Bytes lost to rounding ranges up to powers of two
+    TracyPlot("Device Memory Internal Waste", static_cast<int64_t>(stats.usedBytes - stats.requestedBytes));
+    TracyPlot("Device Memory Largest Free Range", static_cast<int64_t>(stats.largestFreeRange));
+}
+
+void DeviceMemoryAllocator::beginFrame(u32 frameIndex) {
+    releaseDeferredFrees(frameIndex);
+
+    std::lock_guard guard(m_mutex);
+    m_frameIndex = frameIndex;
+}
+
+void DeviceMemoryAllocator::releaseDeferredFrees(u32 frameIndex) {
+    ZoneScoped;
+    std::lock_guard guard(m_mutex);
+    assert(frameIndex < m_deferredFrees.size());
+    for (const auto& deferredFree : m_deferredFrees [frameIndex]) {
+        release(deferredFree);
+    }
+    m_deferredFrees [frameIndex].clear();
+}
+
+void DeviceMemoryAllocator::free(const MemoryAllocation& allocation) {
+    std::lock_guard guard(m_mutex);
+    assert(m_blocks [allocation.m_blockIndex] && *m_blocks [allocation.m_blockIndex]->memory == allocation.memory);
+
+    --m_allocationCount;
+    m_requestedBytes -= allocation.m_requestedSize;
+    m_deferredFrees [m_frameIndex].push_back(DeferredFree {allocation.m_blockIndex, allocation.offset, allocation.size});
+}
+
+void DeviceMemoryAllocator::release(const DeferredFree& deferredFree) {
+    auto& block = m_blocks [deferredFree.blockIndex];
+    if (!block->ranges) {
+        block.reset();
+        return;
+    }
+
+    // The reserved range size maps to the same buddy level as the requested size. Emptied blocks are kept around,
+    // resources get recreated in bursts (e.g. on resize) and would otherwise hit vkAllocateMemory again right away.
+    block->ranges->free(deferredFree.offset, deferredFree.size);
+}
+
+u32 DeviceMemoryAllocator::createBlock(u32 memoryTypeIndex, vk::DeviceSize size, bool optimalTiling, bool dedicated) {
+    ZoneScoped;
+    auto block             = std::make_unique<Block>();
+    block->memory          = vk::raii::DeviceMemory(*m_device, vk::MemoryAllocateInfo(size, memoryTypeIndex));
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->optimalTiling   = optimalTiling;
+    block->size            = size;
+    if (!dedicated) {
+        block->ranges.emplace(size, minMemoryRangeSize);
+    }
+    // Host visible blocks are mapped once, every allocation inside only offsets into the mapping
+    if (m_memoryProperties.memoryTypes [memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block->mapped = static_cast<std::byte*>(block->memory.mapMemory(0, VK_WHOLE_SIZE));
+    }
+
+    const auto hole = std::find(m_blocks.begin(), m_blocks.end(), nullptr);
+    if (hole != m_blocks.end()) {
+        *hole = std::move(block);
+        return static_cast<u32>(std::distance(m_blocks.begin(), hole));
+    }
+    m_blocks.emplace_back(std::move(block));
+    return static_cast<u32>(m_blocks.size() - 1u);
+}
+
+MemoryAllocation DeviceMemoryAllocator::makeAllocation(u32 blockIndex, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize requestedSize) {
+    const Block& block = *m_blocks [blockIndex];
+    return MemoryAllocation(this, *block.memory, offset, size, requestedSize, block.mapped ? block.mapped + offset : nullptr, blockIndex);
+}
+
+vk::DeviceSize DeviceMemoryAllocator::getBlockSize(u32 memoryTypeIndex) const {
+    // Small heaps (e.g. the 256MB device local and host visible one) must not be swallowed by a handful of blocks
+    const vk::DeviceSize heapSize = m_memoryProperties.memoryHeaps [m_memoryProperties.memoryTypes [memoryTypeIndex].heapIndex].size;
+    return std::max(minMemoryRangeSize, std::min(defaultMemoryBlockSize, std::bit_floor(heapSize / 8u)));
 }
 
 WindowData createWindow(const std::string& windowName, const vk::Extent2D& extent) {
@@ -97,6 +252,41 @@ u32 findComputeQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice)
     throw std::runtime_error("Could not find a queue for compute -> terminating");
 }
 
+std::optional<u32> findDedicatedTransferQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice) {
+    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+    assert(queueFamilyProperties.size() < std::numeric_limits<u32>::max());
+
+    const std::vector<vk::QueueFamilyProperties>::iterator transferQueueFamilyProperty = std::find_if(
+      queueFamilyProperties.begin(),
+      queueFamilyProperties.end(),
+      [](const vk::QueueFamilyProperties& qfp) {
+          return (qfp.queueFlags & vk::QueueFlagBits::eTransfer) && !(qfp.queueFlags & vk::QueueFlagBits::eGraphics) &&
+                 !(qfp.queueFlags & vk::QueueFlagBits::eCompute);
+      });
+
+    if (transferQueueFamilyProperty != queueFamilyProperties.end()) {
+        return static_cast<u32>(std::distance(queueFamilyProperties.begin(), transferQueueFamilyProperty));
+    }
+
+    return std::nullopt;
+}
+
+std::optional<u32> findAsyncComputeQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice) {
+    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+    assert(queueFamilyProperties.size() < std::numeric_limits<u32>::max());
+
+    const std::vector<vk::QueueFamilyProperties>::iterator computeQueueFamilyProperty = std::find_if(
+      queueFamilyProperties.begin(),
+      queueFamilyProperties.end(),
+      [](const vk::QueueFamilyProperties& qfp) { return (qfp.queueFlags & vk::QueueFlagBits::eCompute) && !(qfp.queueFlags & vk::QueueFlagBits::eGraphics); });
+
+    if (computeQueueFamilyProperty != queueFamilyProperties.end()) {
+        return static_cast<u32>(std::distance(queueFamilyProperties.begin(), computeQueueFamilyProperty));
+    }
+
+    return std::nullopt;
+}
+
 u32 findMemoryType(const vk::PhysicalDeviceMemoryProperties& memoryProperties, u32 typeBits, vk::MemoryPropertyFlags requirementsMask) {
     u32 typeIndex = u32(~0);
     for (u32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
@@ -183,6 +373,47 @@ std::vector<const char*> gatherLayers(
     return enabledLayers;
 }
 
+void makeSlotsDynamic(std::span<BindingSlot> slots, std::span<const std::string_view> names) {
+    for (auto name : names) {
+        bool foundSlot = false;
+        for (auto& slot : slots) {
+            if (slot.name == name) {
+                foundSlot = true;
+                if (slot.type == vk::DescriptorType::eUniformBuffer) {
+                    slot.type = vk::DescriptorType::eUniformBufferDynamic;
+                }
+                else if (slot.type == vk::DescriptorType::eStorageBuffer) {
+                    slot.type = vk::DescriptorType::eStorageBufferDynamic;
+                }
+                else {
+                    assert(false);
+                }
+                break;
+            }
+        }
+        assert(foundSlot);
+    }
+}
+
+std::vector<u32> orderDynamicOffsets(std::span<const BindingSlot> slots, std::span<const DynamicOffset> offsets) {
+    std::vector<std::pair<u32, u32>> bindingAndOffset;
+    bindingAndOffset.reserve(offsets.size());
+    for (const auto& offset : offsets) {
+        const auto slot = std::find_if(slots.begin(), slots.end(), [&offset](const BindingSlot& slot) { return slot.name == offset.name; });
+        assert(slot != slots.end());
+        assert(slot->type == vk::DescriptorType::eUniformBufferDynamic || slot->type == vk::DescriptorType::eStorageBufferDynamic);
+        bindingAndOffset.emplace_back(slot->bindingSlot, offset.offset);
+    }
+    std::sort(bindingAndOffset.begin(), bindingAndOffset.end());
+
+    std::vector<u32> result;
+    result.reserve(bindingAndOffset.size());
+    for (const auto& [binding, offset] : bindingAndOffset) {
+        result.push_back(offset);
+    }
+    return result;
+}
+
 std::vector<std::string> getDeviceExtensions() {
     return {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME};
 }
@@ -242,7 +473,7 @@ vk::raii::DescriptorSetLayout makeDescriptorSetLayout(
 
 vk::raii::Device makeDevice(
   const vk::raii::PhysicalDevice&   physicalDevice,
-  u32                               queueFamilyIndex,
+  std::span<const u32>              queueFamilyIndices,
   const std::vector<std::string>&   extensions,
   const vk::PhysicalDeviceFeatures* physicalDeviceFeatures,
   const void*                       pNext) {
@@ -252,9 +483,18 @@ vk::raii::Device makeDevice(
         enabledExtensions.push_back(ext.data());
     }
 
-    const float                queuePriority = 0.0f;
-    vk::DeviceQueueCreateInfo  deviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), queueFamilyIndex, 1, &queuePriority);
-    const vk::DeviceCreateInfo deviceCreateInfo(vk::DeviceCreateFlags(), deviceQueueCreateInfo, {}, enabledExtensions, physicalDeviceFeatures, pNext);
+    const float                            queuePriority = 0.0f;
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos;
+    for (u32 queueFamilyIndex : queueFamilyIndices) {
+        const bool alreadyRequested = std::any_of(
+          deviceQueueCreateInfos.begin(),
+          deviceQueueCreateInfos.end(),
+          [queueFamilyIndex](const vk::DeviceQueueCreateInfo& info) { return info.queueFamilyIndex == queueFamilyIndex; });
+        if (!alreadyRequested) {
+            deviceQueueCreateInfos.emplace_back(vk::DeviceQueueCreateFlags(), queueFamilyIndex, 1, &queuePriority);
+        }
+    }
+    const vk::DeviceCreateInfo deviceCreateInfo(vk::DeviceCreateFlags(), deviceQueueCreateInfos, {}, enabledExtensions, physicalDeviceFeatures, pNext);
     return vk::raii::Device(physicalDevice, deviceCreateInfo);
 }
 
@@ -366,6 +606,13 @@ vk::raii::Pipeline makeGraphicsPipeline(
     return vk::raii::Pipeline(device, pipelineCache, graphicsPipelineCreateInfo);
 }
 
+vk::BufferCreateInfo makeBufferCreateInfo(vk::DeviceSize size, vk::BufferUsageFlags usage, std::span<const u32> queueFamilyIndices) {
+    if (queueFamilyIndices.size() > 1) {
+        return vk::BufferCreateInfo({}, size, usage, vk::SharingMode::eConcurrent, queueFamilyIndices);
+    }
+    return vk::BufferCreateInfo({}, size, usage);
+}
+
 vk::raii::Image makeImage(const vk::raii::Device& device) {
     const vk::ImageCreateInfo imageCreateInfo(
       {},
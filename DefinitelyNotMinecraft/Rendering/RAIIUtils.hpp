@@ -19,10 +19,15 @@
 
 #define GLFW_INCLUDE_NONE
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <span>
 
+#include <Core/BuddyAllocator.hpp>
 #include <Core/Config.hpp>
+#include <Core/Math.hpp>
 #include <Core/Profiler.hpp>
 #include <Core/ShortTypes.hpp>
 
@@ -49,30 +54,145 @@ VULKAN_HPP_INLINE TargetType checked_cast(SourceType value) {
 
 u32 findMemoryType(const vk::PhysicalDeviceMemoryProperties& memoryProperties, u32 typeBits, vk::MemoryPropertyFlags requirementsMask);
 
-vk::raii::DeviceMemory allocateDeviceMemory(
-  const vk::raii::Device&                   device,
-  const vk::PhysicalDeviceMemoryProperties& memoryProperties,
-  const vk::MemoryRequirements&             memoryRequirements,
-  vk::MemoryPropertyFlags                   memoryPropertyFlags);
-
-template<typename T>
-void copyToDevice(const vk::raii::DeviceMemory& deviceMemory, std::span<const T> data, vk::DeviceSize stride = sizeof(T)) {
-    ZoneScoped;
-    auto count = data.size();
-    assert(count > 0);
-    assert(sizeof(T) <= stride);
-    uint8_t* deviceData = static_cast<uint8_t*>(deviceMemory.mapMemory(0, count * stride));
-    if (stride == sizeof(T)) {
-        memcpy(deviceData, data.data(), count * sizeof(T));
-    }
-    else {
-        for (size_t i = 0; i < count; i++) {
-            memcpy(deviceData, data.data() + i, sizeof(T));
-            deviceData += stride;
+class DeviceMemoryAllocator;
+
+// Range inside a device memory block, handed back to the allocator on destruction
+struct MemoryAllocation
+{
+    MemoryAllocation(std::nullptr_t) {}
+
+    MemoryAllocation(
+      DeviceMemoryAllocator* allocator,
+      vk::DeviceMemory       memory_,
+      vk::DeviceSize         offset_,
+      vk::DeviceSize         size_,
+      vk::DeviceSize         requestedSize,
+      std::byte*             mapped_,
+      u32                    blockIndex) :
+        memory(memory_),
+        offset(offset_),
+        size(size_),
+        mapped(mapped_),
+        m_allocator(allocator),
+        m_requestedSize(requestedSize),
+        m_blockIndex(blockIndex) {}
+
+    MemoryAllocation(const MemoryAllocation&)            = delete;
+    MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+
+    MemoryAllocation(MemoryAllocation&& other) noexcept { *this = std::move(other); }
+
+    MemoryAllocation& operator=(MemoryAllocation&& other) noexcept {
+        if (this != &other) {
+            release();
+            memory       = other.memory;
+            offset       = other.offset;
+            size         = other.size;
+            mapped       = other.mapped;
+            m_allocator     = std::exchange(other.m_allocator, nullptr);
+            m_requestedSize = other.m_requestedSize;
+            m_blockIndex    = other.m_blockIndex;
         }
+        return *this;
     }
-    deviceMemory.unmapMemory();
-}
+
+    ~MemoryAllocation() { release(); }
+
+    vk::DeviceMemory memory;
+    vk::DeviceSize   offset = 0u;
+    // Size of the reserved range, which can be larger than requested
+    vk::DeviceSize size   = 0u;
+    std::byte*     mapped = nullptr;
+
+    private:
+    friend class DeviceMemoryAllocator;
+
+    void release();
+
+    DeviceMemoryAllocator* m_allocator     = nullptr;
+    vk::DeviceSize         m_requestedSize = 0u;
+    u32                    m_blockIndex    = 0u;
+};
+
+// Sub-allocates buffers and images from large blocks per memory type instead of one vkAllocateMemory each.
+// Ranges are handed out by a buddy allocator per block, requests bigger than half a block get a block of their own.
+// Allocating and releasing is safe from any thread. Released ranges only go back to their block once the frame in
+// flight they were released in comes around again, since earlier submissions may still read them, see beginFrame.
+class DeviceMemoryAllocator {
+    public:
+    struct Stats
+    {
+        u64 blockCount       = 0u;
+        u64 dedicatedCount   = 0u;
+        u64 allocationCount  = 0u;
+        u64 reservedBytes    = 0u;
+        u64 usedBytes        = 0u;
+        u64 requestedBytes   = 0u;
+        u64 largestFreeRange = 0u;
+    };
+
+    DeviceMemoryAllocator(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, u32 framesInFlight);
+
+    DeviceMemoryAllocator(const DeviceMemoryAllocator&)            = delete;
+    DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+    // Optimal tiling images live in blocks of their own so neighbouring ranges never have to respect bufferImageGranularity
+    MemoryAllocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags propertyFlags, bool optimalTiling = false);
+
+    const vk::raii::PhysicalDevice& getPhysicalDevice() const;
+    const vk::raii::Device&         getDevice() const;
+
+    Stats getStats() const;
+    void  plotStats() const;
+
+    // Has to be called once the fence of the frame in flight was waited on. Hands the ranges released while it was
+    // recorded the last time back and collects the ones released from now on.
+    void beginFrame(u32 frameIndex);
+    // For frames in flight which are not recorded anymore, e.g. after lowering the count, once their fence signaled
+    void releaseDeferredFrees(u32 frameIndex);
+
+    private:
+    struct Block
+    {
+        vk::raii::DeviceMemory        memory {nullptr};
+        std::byte*                    mapped {nullptr};
+        u32                           memoryTypeIndex = 0u;
+        bool                          optimalTiling   = false;
+        vk::DeviceSize                size            = 0u;
+        // Empty for dedicated blocks
+        std::optional<BuddyAllocator> ranges;
+    };
+
+    friend struct MemoryAllocation;
+
+    struct DeferredFree
+    {
+        u32            blockIndex = 0u;
+        vk::DeviceSize offset     = 0u;
+        vk::DeviceSize size       = 0u;
+    };
+
+    void             free(const MemoryAllocation& allocation);
+    void             release(const DeferredFree& deferredFree);
+    u32              createBlock(u32 memoryTypeIndex, vk::DeviceSize size, bool optimalTiling, bool dedicated);
+    MemoryAllocation makeAllocation(u32 blockIndex, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize requestedSize);
+    vk::DeviceSize   getBlockSize(u32 memoryTypeIndex) const;
+
+    const vk::raii::PhysicalDevice*    m_physicalDevice;
+    const vk::raii::Device*            m_device;
+    vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+
+    // Released dedicated blocks leave a null entry behind which is reused, so block indices stay stable
+    std::vector<std::unique_ptr<Block>> m_blocks;
+
+    u64 m_allocationCount = 0u;
+    u64 m_requestedBytes  = 0u;
+
+    std::vector<std::vector<DeferredFree>> m_deferredFrees;
+    u32                                    m_frameIndex = 0u;
+
+    mutable std::mutex m_mutex;
+};
 
 template<typename Func>
 void oneTimeSubmit(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Queue& queue, const Func& func) {
@@ -98,84 +218,99 @@ void setImageLayout(
   vk::ImageLayout                newImageLayout,
   u32                            baseMip = 0);
 
+// Resources touched by more than one queue family are shared concurrently, which saves us the queue ownership transfers
+vk::BufferCreateInfo makeBufferCreateInfo(vk::DeviceSize size, vk::BufferUsageFlags usage, std::span<const u32> queueFamilyIndices);
+
+// Host visible buffers stay mapped for their whole lifetime
 struct BufferData
 {
     BufferData(
-      const vk::raii::PhysicalDevice& physicalDevice,
-      const vk::raii::Device&         device,
-      vk::DeviceSize                  size,
-      vk::BufferUsageFlags            usage,
-      vk::MemoryPropertyFlags         propertyFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent) :
-        buffer(device, vk::BufferCreateInfo({}, size, usage)),
-        deviceMemory(allocateDeviceMemory(device, physicalDevice.getMemoryProperties(), buffer.getMemoryRequirements(), propertyFlags))
+      DeviceMemoryAllocator&  allocator,
+      vk::DeviceSize          size,
+      vk::BufferUsageFlags    usage,
+      vk::MemoryPropertyFlags propertyFlags      = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+      std::span<const u32>    queueFamilyIndices = {}) :
+        buffer(allocator.getDevice(), makeBufferCreateInfo(size, usage, queueFamilyIndices)),
+        allocation(allocator.allocate(buffer.getMemoryRequirements(), propertyFlags)),
+        m_device(&allocator.getDevice()),
+        m_size(size),
+        m_coherent(static_cast<bool>(propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent))
 #if !defined(NDEBUG)
         ,
-        m_size(size),
         m_usage(usage),
         m_propertyFlags(propertyFlags)
 #endif
     {
-        buffer.bindMemory(*deviceMemory, 0);
+        buffer.bindMemory(allocation.memory, allocation.offset);
+        if (propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+            m_mapped = allocation.mapped;
+            if (!m_coherent) {
+                m_nonCoherentAtomSize = allocator.getPhysicalDevice().getProperties().limits.nonCoherentAtomSize;
+            }
+        }
     }
 
     BufferData(std::nullptr_t) {}
 
-    template<typename DataType>
-    void upload(const DataType& data) const {
-        assert((m_propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent) && (m_propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible));
-        assert(sizeof(DataType) <= m_size);
-
-        void* dataPtr = deviceMemory.mapMemory(0, sizeof(DataType));
-        memcpy(dataPtr, &data, sizeof(DataType));
-        deviceMemory.unmapMemory();
+    std::byte* getMapped() const {
+        assert(m_mapped);
+        return m_mapped;
     }
 
-    template<typename DataType>
-    void upload(const std::vector<DataType>& data, size_t stride = 0) const {
-        assert(m_propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+    vk::DeviceSize getSize() const { return m_size; }
 
-        size_t elementSize = stride ? stride : sizeof(DataType);
-        assert(sizeof(DataType) <= elementSize);
+    template<typename T>
+    void write(std::span<const T> data, vk::DeviceSize offset = 0u, vk::DeviceSize stride = sizeof(T)) const {
+        ZoneScoped;
+        const auto count = data.size();
+        assert(count > 0);
+        assert(sizeof(T) <= stride);
+        assert(offset + count * stride <= m_size);
 
-        copyToDevice(deviceMemory, data.data(), data.size(), elementSize);
+        std::byte* destination = getMapped() + offset;
+        if (stride == sizeof(T)) {
+            memcpy(destination, data.data(), count * sizeof(T));
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                memcpy(destination, data.data() + i, sizeof(T));
+                destination += stride;
+            }
+        }
+        flush(offset, count * stride);
     }
 
-    template<typename DataType>
-    void upload(
-      const vk::raii::PhysicalDevice& physicalDevice,
-      const vk::raii::Device&         device,
-      const vk::raii::CommandPool&    commandPool,
-      const vk::raii::Queue&          queue,
-      const std::vector<DataType>&    data,
-      size_t                          stride) const {
-        assert(m_usage & vk::BufferUsageFlagBits::eTransferDst);
-        assert(m_propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-        size_t elementSize = stride ? stride : sizeof(DataType);
-        assert(sizeof(DataType) <= elementSize);
-
-        size_t dataSize = data.size() * elementSize;
-        assert(dataSize <= m_size);
-
-        BufferData stagingBuffer(physicalDevice, device, dataSize, vk::BufferUsageFlagBits::eTransferSrc);
-        copyToDevice(stagingBuffer.deviceMemory, data.data(), data.size(), elementSize);
-
-        dnm::oneTimeSubmit(
-          device,
-          commandPool,
-          queue,
-          [&](const vk::raii::CommandBuffer& commandBuffer)
-          { commandBuffer.copyBuffer(*stagingBuffer.buffer, *this->buffer, vk::BufferCopy(0, 0, dataSize)); });
+    template<typename T>
+    void write(const T& value, vk::DeviceSize offset = 0u) const {
+        write(std::span<const T>(&value, 1u), offset);
+    }
+
+    // Writes through the typed helpers flush on their own, only direct writes to getMapped() have to call this
+    void flush(vk::DeviceSize offset = 0u, vk::DeviceSize size = VK_WHOLE_SIZE) const {
+        if (m_coherent) {
+            return;
+        }
+        // Flushed ranges are relative to the whole block and have to be multiples of the atom size. Blocks and
+        // ranges are power of two sized, so rounding up never leaves the range reserved for this buffer.
+        const vk::DeviceSize begin         = allocation.offset + offset;
+        const vk::DeviceSize end           = allocation.offset + (size == VK_WHOLE_SIZE ? m_size : offset + size);
+        const vk::DeviceSize alignedOffset = begin - begin % m_nonCoherentAtomSize;
+        const vk::DeviceSize alignedEnd    = std::min(alignUp(end, m_nonCoherentAtomSize), allocation.offset + allocation.size);
+        m_device->flushMappedMemoryRanges(vk::MappedMemoryRange(allocation.memory, alignedOffset, alignedEnd - alignedOffset));
     }
 
-    // the order of buffer and deviceMemory here is important to get the
+    // the order of buffer and allocation here is important to get the
     // constructor running !
-    vk::raii::Buffer       buffer       = nullptr;
-    vk::raii::DeviceMemory deviceMemory = nullptr;
-#if !defined(NDEBUG)
+    vk::raii::Buffer buffer     = nullptr;
+    MemoryAllocation allocation = nullptr;
 
     private:
-    vk::DeviceSize          m_size;
+    const vk::raii::Device* m_device              = nullptr;
+    vk::DeviceSize          m_size                = 0u;
+    bool                    m_coherent            = true;
+    vk::DeviceSize          m_nonCoherentAtomSize = 1u;
+    std::byte*              m_mapped              = nullptr;
+#if !defined(NDEBUG)
     vk::BufferUsageFlags    m_usage;
     vk::MemoryPropertyFlags m_propertyFlags;
 #endif
@@ -184,19 +319,19 @@ struct BufferData
 struct ImageData
 {
     ImageData(
-      const vk::raii::PhysicalDevice& physicalDevice,
-      const vk::raii::Device&         device,
-      vk::Format                      format_,
-      const vk::Extent2D&             extent,
-      vk::ImageTiling                 tiling,
-      vk::ImageUsageFlags             usage,
-      vk::ImageLayout                 initialLayout,
-      vk::MemoryPropertyFlags         memoryProperties,
-      vk::ImageAspectFlags            aspectMask,
-      u32                             mipCount = 1) :
+      DeviceMemoryAllocator&  allocator,
+      vk::Format              format_,
+      const vk::Extent2D&     extent,
+      vk::ImageTiling         tiling,
+      vk::ImageUsageFlags     usage,
+      vk::ImageLayout         initialLayout,
+      vk::MemoryPropertyFlags memoryProperties,
+      vk::ImageAspectFlags    aspectMask,
+      u32                     mipCount           = 1,
+      std::span<const u32>    queueFamilyIndices = {}) :
         format(format_),
         image(
-          device,
+          allocator.getDevice(),
           {vk::ImageCreateFlags(),
            vk::ImageType::e2D,
            format,
@@ -206,34 +341,35 @@ struct ImageData
            vk::SampleCountFlagBits::e1,
            tiling,
            usage | vk::ImageUsageFlagBits::eSampled,
-           vk::SharingMode::eExclusive,
-           {},
+           queueFamilyIndices.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+           queueFamilyIndices.size() > 1 ? checked_cast<u32>(queueFamilyIndices.size()) : 0u,
+           queueFamilyIndices.size() > 1 ? queueFamilyIndices.data() : nullptr,
            initialLayout}),
-        deviceMemory(allocateDeviceMemory(device, physicalDevice.getMemoryProperties(), image.getMemoryRequirements(), memoryProperties)) {
-        image.bindMemory(*deviceMemory, 0);
-        imageView = vk::raii::ImageView(device, vk::ImageViewCreateInfo({}, *image, vk::ImageViewType::e2D, format, {}, {aspectMask, 0, mipCount, 0, 1}));
+        allocation(allocator.allocate(image.getMemoryRequirements(), memoryProperties, tiling == vk::ImageTiling::eOptimal)) {
+        image.bindMemory(allocation.memory, allocation.offset);
+        imageView = vk::raii::ImageView(allocator.getDevice(), vk::ImageViewCreateInfo({}, *image, vk::ImageViewType::e2D, format, {}, {aspectMask, 0, mipCount, 0, 1}));
     }
 
     ImageData(std::nullptr_t) {}
 
-    vk::Format             format;
-    vk::raii::Image        image        = nullptr;
-    vk::raii::DeviceMemory deviceMemory = nullptr;
-    vk::raii::ImageView    imageView    = nullptr;
+    vk::Format          format;
+    vk::raii::Image     image      = nullptr;
+    MemoryAllocation    allocation = nullptr;
+    vk::raii::ImageView imageView  = nullptr;
 };
 
 struct DepthBufferData : public ImageData
 {
     DepthBufferData(std::nullptr_t) : ImageData(nullptr) {}
 
-    DepthBufferData(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, vk::Format format, const vk::Extent2D& extent) :
+    DepthBufferData(DeviceMemoryAllocator& allocator, vk::Format format, const vk::Extent2D& extent) :
         ImageData(
-          physicalDevice,
-          device,
+          allocator,
           format,
           extent,
           vk::ImageTiling::eOptimal,
-          vk::ImageUsageFlagBits::eDepthStencilAttachment,
+          // Copied into the depth pyramid for the occlusion culling
+          vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc,
           vk::ImageLayout::eUndefined,
           vk::MemoryPropertyFlagBits::eDeviceLocal,
           vk::ImageAspectFlagBits::eDepth) {}
@@ -380,20 +516,20 @@ struct TextureData
     TextureData(std::nullptr_t) : sampler {nullptr} {};
 
     TextureData(
-      const vk::raii::PhysicalDevice& physicalDevice,
-      const vk::raii::Device&         device,
-      const vk::Extent2D&             extent_            = {256, 256},
-      vk::Format                      format_            = vk::Format::eR8G8B8A8Unorm,
-      vk::SamplerAddressMode          addressMode        = vk::SamplerAddressMode::eRepeat,
-      u32                             mipCount           = 1,
-      vk::ImageUsageFlags             usageFlags         = {},
-      vk::FormatFeatureFlags          formatFeatureFlags = {},
-      bool                            anisotropyEnable   = false,
-      bool                            forceStaging       = false) :
+      DeviceMemoryAllocator& allocator,
+      const vk::Extent2D&    extent_            = {256, 256},
+      vk::Format             format_            = vk::Format::eR8G8B8A8Unorm,
+      vk::SamplerAddressMode addressMode        = vk::SamplerAddressMode::eRepeat,
+      u32                    mipCount           = 1,
+      vk::ImageUsageFlags    usageFlags         = {},
+      vk::FormatFeatureFlags formatFeatureFlags = {},
+      bool                   anisotropyEnable   = false,
+      bool                   forceStaging       = false,
+      std::span<const u32>   queueFamilyIndices = {}) :
         format(format_),
         extent(extent_),
         sampler(
-          device,
+          allocator.getDevice(),
           {{},
            vk::Filter::eNearest,
            vk::Filter::eNearest,
@@ -409,7 +545,7 @@ struct TextureData
            0.0f,
            static_cast<float>(mipCount),
            vk::BorderColor::eFloatOpaqueBlack}) {
-        vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(format);
+        vk::FormatProperties formatProperties = allocator.getPhysicalDevice().getFormatProperties(format);
 
         formatFeatureFlags |= vk::FormatFeatureFlagBits::eSampledImage;
         needsStaging = forceStaging || ((formatProperties.linearTilingFeatures & formatFeatureFlags) != formatFeatureFlags);
@@ -418,7 +554,7 @@ struct TextureData
         vk::MemoryPropertyFlags requirements;
         if (needsStaging) {
             assert((formatProperties.optimalTilingFeatures & formatFeatureFlags) == formatFeatureFlags);
-            stagingBufferData = BufferData(physicalDevice, device, extent.width * extent.height * 4, vk::BufferUsageFlagBits::eTransferSrc);
+            stagingBufferData = BufferData(allocator, extent.width * extent.height * 4, vk::BufferUsageFlagBits::eTransferSrc);
             imageTiling       = vk::ImageTiling::eOptimal;
             usageFlags |= vk::ImageUsageFlagBits::eTransferDst;
             initialLayout = vk::ImageLayout::eUndefined;
@@ -429,8 +565,7 @@ struct TextureData
             requirements  = vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible;
         }
         imageData = ImageData(
-          physicalDevice,
-          device,
+          allocator,
           format,
           extent,
           imageTiling,
@@ -438,14 +573,19 @@ struct TextureData
           initialLayout,
           requirements,
           vk::ImageAspectFlagBits::eColor,
-          mipCount);
+          mipCount,
+          queueFamilyIndices);
     }
 
     void setImage(const vk::raii::CommandBuffer& commandBuffer, void* textureData, bool setShaderReadOnlyOptimal = true, u32 mipLevels = 1) const {
-        u64   neededSize = needsStaging ? stagingBufferData.buffer.getMemoryRequirements().size : imageData.image.getMemoryRequirements().size;
-        void* data       = needsStaging ? stagingBufferData.deviceMemory.mapMemory(0, neededSize) : imageData.deviceMemory.mapMemory(0, neededSize);
-        memcpy(data, textureData, neededSize);
-        needsStaging ? stagingBufferData.deviceMemory.unmapMemory() : imageData.deviceMemory.unmapMemory();
+        if (needsStaging) {
+            memcpy(stagingBufferData.getMapped(), textureData, stagingBufferData.getSize());
+            stagingBufferData.flush();
+        }
+        else {
+            const u64 neededSize = imageData.image.getMemoryRequirements().size;
+            memcpy(imageData.allocation.mapped, textureData, neededSize);
+        }
 
         if (needsStaging) {
             // Since we're going to blit to the texture image, set its layout to
@@ -487,6 +627,12 @@ struct TextureData
 
 u32 findGraphicsQueueFamilyIndex(const std::vector<vk::QueueFamilyProperties>& queueFamilyProperties);
 
+// Returns a family which only supports transfers (typically backed by the DMA engines), if the device exposes one
+std::optional<u32> findDedicatedTransferQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice);
+
+// Returns a family which supports compute but not graphics, its queue runs next to the graphics queue
+std::optional<u32> findAsyncComputeQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice);
+
 std::pair<u32, u32> findGraphicsAndPresentQueueFamilyIndex(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::SurfaceKHR& surface);
 
 vk::raii::CommandBuffer makeCommandBuffer(const vk::raii::Device& device, const vk::raii::CommandPool& commandPool);
@@ -504,9 +650,10 @@ vk::raii::DescriptorSetLayout makeDescriptorSetLayout(
   vk::ShaderStageFlags               stageFlags,
   vk::DescriptorSetLayoutCreateFlags flags = {});
 
+// Creates one queue for each distinct family in queueFamilyIndices
 vk::raii::Device makeDevice(
   const vk::raii::PhysicalDevice&   physicalDevice,
-  u32                               queueFamilyIndex,
+  std::span<const u32>              queueFamilyIndices,
   const std::vector<std::string>&   extensions             = {},
   const vk::PhysicalDeviceFeatures* physicalDeviceFeatures = nullptr,
   const void*                       pNext                  = nullptr);
@@ -618,6 +765,19 @@ void updateDescriptorSets(
   std::span<BindingSlot>          slots,
   std::span<TextureSlotUpdate>    textures = {});
 
+// Turns the named uniform and storage buffer slots into their dynamic counterparts, which have to be updated with an
+// explicit size instead of VK_WHOLE_SIZE
+void makeSlotsDynamic(std::span<BindingSlot> slots, std::span<const std::string_view> names);
+
+struct DynamicOffset
+{
+    std::string_view name;
+    u32              offset;
+};
+
+// Dynamic offsets are consumed in the order of the binding numbers
+std::vector<u32> orderDynamicOffsets(std::span<const BindingSlot> slots, std::span<const DynamicOffset> offsets);
+
 std::vector<std::string> getDeviceExtensions();
 
 std::vector<std::string> getInstanceExtensions();
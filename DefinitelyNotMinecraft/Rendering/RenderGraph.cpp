@@ -1,11 +1,86 @@
 #include "Rendering/RenderGraph.hpp"
 
-#include <Rendering/Renderer.hpp>
-#include <RenderingNodes/IRenderingNode.hpp>
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+#include <Core/Chrono.hpp>
+#include <Core/Profiler.hpp>
+
+#include <Logic/Camera.hpp>
 
 namespace dnm
 {
-RenderGraph::RenderGraph(Renderer* renderer, Camera* camera) : m_renderer(renderer), m_camera {camera} {}
+namespace
+{
+    constexpr vk::AccessFlags readAccess = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead |
+                                           vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eUniformRead |
+                                           vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eColorAttachmentRead |
+                                           vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eTransferRead;
+
+    // The stage bits of the first synchronization keep their values in the 64 bit flags
+    vk::PipelineStageFlags2 toStageFlags2(vk::PipelineStageFlags stages) {
+        return vk::PipelineStageFlags2(static_cast<VkPipelineStageFlags2>(static_cast<VkPipelineStageFlags>(stages)));
+    }
+
+    u32 getRecordingWorkerCount() {
+        return std::max(1u, std::thread::hardware_concurrency() / 4u);
+    }
+
+    struct NodeSubmission
+    {
+        std::vector<vk::SemaphoreSubmitInfo>     waits;
+        std::vector<vk::CommandBufferSubmitInfo> commandBuffers;
+        std::vector<vk::SemaphoreSubmitInfo>     signals;
+        vk::Queue                                queue;
+    };
+
+    struct ResourceAccess
+    {
+        u32                  node;
+        const ResourceUsage* usage;
+    };
+
+    struct ResourceState
+    {
+        std::optional<ResourceAccess> lastWrite;
+        std::vector<ResourceAccess>   readsSinceWrite;
+    };
+}   // namespace
+
+RenderGraph::RenderGraph(Config* config, Renderer* renderer, Camera* camera, JobSystem* jobSystem) :
+    m_config {config}, m_renderer(renderer), m_camera {camera}, m_jobSystem {jobSystem}, m_laneCount {getRecordingWorkerCount()} {
+    m_jobSystem->addWorkers(m_laneCount);
+
+    const auto&                       device = m_renderer->getDevice();
+    const vk::SemaphoreTypeCreateInfo timelineInfo(vk::SemaphoreType::eTimeline, 0u);
+    for (auto& timeline : m_timelines) {
+        timeline = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo({}, &timelineInfo));
+    }
+    registerDebugMarker(device, m_timelines [GraphicsQueue], "Graphics Timeline");
+    registerDebugMarker(device, m_timelines [ComputeQueue], "Compute Timeline");
+
+    // Timestamps are written on the graphics and the compute queue
+    const auto& physicalDevice = m_renderer->getPhysicalDevice();
+    const auto  families       = physicalDevice.getQueueFamilyProperties();
+    const auto  indices        = m_renderer->getIndices();
+    m_timestampsSupported      = families [indices.graphicsQueueFamilyIndex].timestampValidBits > 0u &&
+                            families [indices.computeQueueFamilyIndex].timestampValidBits > 0u;
+    m_timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+    m_renderer->getUploader().setWaitResolver([this](vk::Buffer destination, std::vector<StagingUploader::TimelineWait>& waits)
+                                              { addUploadWaits(destination, waits); });
+}
+
+RenderGraph::~RenderGraph() {
+    // The frames in flight still use the command buffers and semaphores
+    m_renderer->waitIdle();
+    m_renderer->getUploader().setWaitResolver({});
+}
 
 void RenderGraph::registerNode(std::unique_ptr<IRenderingNode> node) {
     m_nodes.emplace_back(std::move(node));
@@ -17,45 +92,650 @@ bool RenderGraph::prepareFrame() {
 }
 
 void RenderGraph::build() {
+    ZoneScoped;
     const auto& device = m_renderer->getDevice();
-    m_sortedNodes.clear();
-    m_sortedNodes.reserve(m_sortedNodes.size());
+    auto&       frame  = m_frames [m_renderer->getFrameIndex()];
+    m_createdObjects   = 0u;
+
+    if (frame.lanes.empty()) {
+        frame.lanes.resize(m_laneCount);
+        if (m_timestampsSupported) {
+            // A start and an end timestamp per node, reset from the host before they are written
+            const u32 queryCount = 2u * static_cast<u32>(m_nodes.size());
+            frame.timestampPool  = vk::raii::QueryPool(device, vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, queryCount));
+            frame.timestampPool.reset(0u, queryCount);
+            ++m_createdObjects;
+        }
+    }
+    else {
+        // The last frame which used these resources is done, so its timings are complete
+        readTimestamps(frame);
+        if (m_config->dumpRenderGraph) {
+            dumpCompiledGraph(frame);
+            m_config->dumpRenderGraph = false;
+        }
+
+        // Every command buffer of the frame is reset at once
+        for (auto* commandPool : {&frame.graphicsCommandPool, &frame.computeCommandPool}) {
+            if (**commandPool) {
+                commandPool->reset();
+            }
+        }
+        for (auto& lane : frame.lanes) {
+            if (*lane.commandPool) {
+                lane.commandPool.reset();
+            }
+        }
+    }
+
+    compile(frame);
+
+    if (frame.nodeResources.size() < frame.compiledNodes.size()) {
+        frame.nodeResources.resize(frame.compiledNodes.size());
+    }
+    assignCommandBuffers(frame);
+    TracyPlot("Render Graph Created Objects", static_cast<i64>(m_createdObjects));
+
+    std::vector<NodeSetEntry> nodeSet;
+    nodeSet.reserve(frame.compiledNodes.size());
+    for (const auto& compiled : frame.compiledNodes) {
+        nodeSet.emplace_back(compiled.node, compiled.queue, compiled.staticCommandBuffer != nullptr);
+    }
+    if (nodeSet != m_builtNodeSet || m_builtSwapChainVersion != m_renderer->getSwapChainVersion()) {
+        m_builtNodeSet          = std::move(nodeSet);
+        m_builtSwapChainVersion = m_renderer->getSwapChainVersion();
+        m_builtWithNodeSet      = {};
+    }
+    // Once a frame in flight was built with this node set, its pools, command buffers and queries have to be reused
+    if (m_builtWithNodeSet [m_renderer->getFrameIndex()] && m_createdObjects > 0u) {
+        throw std::runtime_error(std::format("Render graph created {} Vulkan objects for an unchanged node set", m_createdObjects));
+    }
+    m_builtWithNodeSet [m_renderer->getFrameIndex()] = true;
+    TracyPlot("Render Graph Culled Nodes", static_cast<i64>(frame.culledNodes.size()));
+}
+
+void RenderGraph::compile(FrameResources& frame) const {
+    ZoneScoped;
+    std::vector<IRenderingNode*>            candidates;
+    std::vector<std::vector<ResourceUsage>> usages;
     for (const auto& node : m_nodes) {
         if (node->shouldExecute()) {
-            auto name          = node->getName();
-            auto commandBuffer = m_renderer->getCommandBuffer();
-            registerDebugMarker(device, commandBuffer, name);
+            candidates.emplace_back(node.get());
+            usages.emplace_back(node->getResourceUsages());
+        }
+    }
+    const u32 candidateCount = static_cast<u32>(candidates.size());
+
+    // Registration order is the order the nodes touch their resources in, so every dependency points to an earlier node
+    std::vector<std::vector<Dependency>> dependencies(candidateCount);
+    std::vector<std::vector<u32>>        producers(candidateCount);
+
+    auto addDependency = [&](u32 node, const ResourceAccess& source, const ResourceUsage& usage, bool memory)
+    {
+        if (source.node == node) {
+            return;
+        }
+        const vk::AccessFlags srcAccess = memory ? source.usage->access : vk::AccessFlags {};
+        const vk::AccessFlags dstAccess = memory ? usage.access : vk::AccessFlags {};
 
-            auto semaphore = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo());
-            registerDebugMarker(device, semaphore, "Gizmo rendering finished");
+        auto& nodeDependencies = dependencies [node];
+        auto  it               = std::ranges::find(nodeDependencies, source.node, &Dependency::source);
+        if (it == nodeDependencies.end()) {
+            nodeDependencies.push_back(Dependency {source.node, source.usage->stages, srcAccess, usage.stages, dstAccess});
+            return;
+        }
+        it->srcStages |= source.usage->stages;
+        it->srcAccess |= srcAccess;
+        it->dstStages |= usage.stages;
+        it->dstAccess |= dstAccess;
+    };
+
+    std::unordered_map<Resource, ResourceState> states;
+    for (u32 node = 0u; node < candidateCount; ++node) {
+        for (const auto& usage : usages [node]) {
+            auto& state = states [usage.resource];
+            if (state.lastWrite) {
+                addDependency(node, *state.lastWrite, usage, true);
+                if ((usage.access & readAccess) && state.lastWrite->node != node) {
+                    producers [node].emplace_back(state.lastWrite->node);
+                }
+            }
+
+            if (!usage.write) {
+                state.readsSinceWrite.push_back(ResourceAccess {node, &usage});
+                continue;
+            }
+            // Nothing the readers wrote has to become visible, the write only has to wait for them to finish
+            for (const auto& read : state.readsSinceWrite) {
+                addDependency(node, read, usage, false);
+            }
+            state.readsSinceWrite.clear();
+            state.lastWrite = ResourceAccess {node, &usage};
+        }
+    }
+
+    // Walking backwards, every consumer is decided on before the nodes it reads from
+    std::vector<bool> kept(candidateCount, false);
+    for (u32 node = candidateCount; node-- > 0u;) {
+        const bool writesAny        = std::ranges::any_of(usages [node], &ResourceUsage::write);
+        const bool writesAttachment = std::ranges::any_of(
+          usages [node], [](const ResourceUsage& usage) { return usage.write && std::holds_alternative<Attachment>(usage.resource); });
+        if (!writesAny || writesAttachment) {
+            kept [node] = true;
+        }
+        if (kept [node]) {
+            for (const u32 producer : producers [node]) {
+                kept [producer] = true;
+            }
+        }
+    }
+
+    frame.compiledNodes.clear();
+    frame.culledNodes.clear();
+    std::vector<u32> compiledIndices(candidateCount, 0u);
+    for (u32 node = 0u; node < candidateCount; ++node) {
+        if (!kept [node]) {
+            frame.culledNodes.emplace_back(candidates [node]->getName());
+            continue;
+        }
+
+        compiledIndices [node] = static_cast<u32>(frame.compiledNodes.size());
+        auto& compiled         = frame.compiledNodes.emplace_back();
+        compiled.node          = candidates [node];
+        compiled.usages        = std::move(usages [node]);
+        compiled.queue         = candidates [node]->runsOnComputeQueue() ? ComputeQueue : GraphicsQueue;
+        for (auto dependency : dependencies [node]) {
+            // Readers which were culled don't run, so there is nothing to wait for
+            if (kept [dependency.source]) {
+                dependency.source = compiledIndices [dependency.source];
+                compiled.dependencies.emplace_back(dependency);
+            }
+        }
+    }
+}
+
+const vk::raii::Queue& RenderGraph::getQueue(QueueIndex queue) const {
+    return queue == ComputeQueue ? m_renderer->getComputeQueue() : m_renderer->getGraphicsQueue();
+}
+
+RenderGraph::StaticCommandBuffer& RenderGraph::getStaticCommandBuffer(const IRenderingNode* node, u32 family) {
+    const auto& device    = m_renderer->getDevice();
+    auto&       recording = m_staticRecordings [node];
+    if (recording.family != family) {
+        if (*recording.commandPool) {
+            // Earlier frames may still execute the recordings for the old family
+            m_renderer->waitIdle();
+        }
+        recording.commandBuffers = {};
+        recording.commandPool    = vk::raii::CommandPool(device, {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, family});
+        recording.family         = family;
+        ++m_createdObjects;
+    }
+    if (recording.swapChainVersion != m_renderer->getSwapChainVersion()) {
+        // The recordings still point at the frame buffers of the old swap chain
+        for (auto& commandBuffers : recording.commandBuffers) {
+            for (auto& staticCommandBuffer : commandBuffers) {
+                staticCommandBuffer.version.reset();
+            }
+        }
+        recording.swapChainVersion = m_renderer->getSwapChainVersion();
+    }
+
+    // Allocated for every swap chain image at once, so later images don't create anything once the frame is steady
+    auto& commandBuffers = recording.commandBuffers [m_renderer->getFrameIndex()];
+    while (commandBuffers.size() < std::max(m_renderer->getSwapChainImageCount(), m_frameBufferIndex + 1u)) {
+        auto& staticCommandBuffer         = commandBuffers.emplace_back();
+        staticCommandBuffer.commandBuffer = makeCommandBuffer(device, recording.commandPool);
+        registerDebugMarker(device, staticCommandBuffer.commandBuffer, node->getName());
+        ++m_createdObjects;
+    }
+    return commandBuffers [m_frameBufferIndex];
+}
+
+vk::raii::CommandPool& RenderGraph::getCommandPool(FrameResources& frame, QueueIndex queue) {
+    const auto indices   = m_renderer->getIndices();
+    const bool dedicated = queue == ComputeQueue && indices.computeQueueFamilyIndex != indices.graphicsQueueFamilyIndex;
+    auto&      pool      = dedicated ? frame.computeCommandPool : frame.graphicsCommandPool;
+    if (!*pool) {
+        const u32 family = dedicated ? indices.computeQueueFamilyIndex : indices.graphicsQueueFamilyIndex;
+        pool             = vk::raii::CommandPool(m_renderer->getDevice(), {vk::CommandPoolCreateFlagBits::eTransient, family});
+        ++m_createdObjects;
+    }
+    return pool;
+}
+
+void RenderGraph::assignCommandBuffers(FrameResources& frame) {
+    const auto& device        = m_renderer->getDevice();
+    const auto  indices       = m_renderer->getIndices();
+    const u32   laneCount     = static_cast<u32>(frame.lanes.size());
+    u32         parallelCount = 0u;
+    for (u64 i = 0u; i < frame.compiledNodes.size(); ++i) {
+        auto& compiled  = frame.compiledNodes [i];
+        auto& resources = frame.nodeResources [i];
+
+        const u32 family = compiled.queue == ComputeQueue ? indices.computeQueueFamilyIndex : indices.graphicsQueueFamilyIndex;
+        if (resources.family != family) {
+            auto& commandPool               = getCommandPool(frame, compiled.queue);
+            resources.commandBuffer         = makeCommandBuffer(device, commandPool);
+            resources.prologueCommandBuffer = makeCommandBuffer(device, commandPool);
+            resources.epilogueCommandBuffer = makeCommandBuffer(device, commandPool);
+            resources.family                = family;
+            resources.markedNode            = nullptr;
+            m_createdObjects += 3u;
+        }
+        // Only reset once they are recorded again, so they neither use the frame's pools nor a lane
+        if (compiled.node->getStaticVersion()) {
+            compiled.staticCommandBuffer = &getStaticCommandBuffer(compiled.node, family);
+            compiled.commandBuffer       = &compiled.staticCommandBuffer->commandBuffer;
+            continue;
+        }
+
+        auto*            commandBuffer = &resources.commandBuffer;
+        IRenderingNode** markedNode    = &resources.markedNode;
+
+        // Spread round robin, so every lane records about as many nodes. The lanes only have graphics pools.
+        if (compiled.node->recordsInParallel() && family == indices.graphicsQueueFamilyIndex) {
+            const u32 lane = parallelCount % laneCount;
+            const u32 slot = parallelCount / laneCount;
+            ++parallelCount;
+
+            auto& recordingLane = frame.lanes [lane];
+            if (!*recordingLane.commandPool) {
+                recordingLane.commandPool = vk::raii::CommandPool(device, {vk::CommandPoolCreateFlagBits::eTransient, indices.graphicsQueueFamilyIndex});
+                ++m_createdObjects;
+            }
+            while (recordingLane.commandBuffers.size() <= slot) {
+                recordingLane.commandBuffers.emplace_back(makeCommandBuffer(device, recordingLane.commandPool));
+                recordingLane.markedNodes.emplace_back(nullptr);
+                ++m_createdObjects;
+            }
 
-            m_sortedNodes.emplace_back(std::move(semaphore), std::move(commandBuffer), node.get());
+            compiled.lane = lane;
+            commandBuffer = &recordingLane.commandBuffers [slot];
+            markedNode    = &recordingLane.markedNodes [slot];
         }
+
+        compiled.commandBuffer = commandBuffer;
+        if (*markedNode != compiled.node) {
+            registerDebugMarker(device, *commandBuffer, compiled.node->getName());
+            *markedNode = compiled.node;
+        }
+    }
+}
+
+void RenderGraph::readTimestamps(FrameResources& frame) const {
+    if (!frame.timestampsWritten) {
+        return;
+    }
+    frame.timestampsWritten = false;
+
+    const u32  queryCount           = 2u * static_cast<u32>(frame.compiledNodes.size());
+    const auto [result, timestamps] = frame.timestampPool.getResults<u64>(0u, queryCount, queryCount * sizeof(u64), sizeof(u64), vk::QueryResultFlagBits::e64);
+    frame.timestampPool.reset(0u, queryCount);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    constexpr float nanosecondsPerMillisecond = 1000000.0f;
+    for (u64 i = 0u; i < frame.compiledNodes.size(); ++i) {
+        const u64 ticks               = timestamps [2u * i + 1u] - timestamps [2u * i];
+        frame.compiledNodes [i].gpuMs = static_cast<float>(ticks) * m_timestampPeriod / nanosecondsPerMillisecond;
     }
 }
 
 void RenderGraph::execute() {
-    for (auto i = 0u; i < m_sortedNodes.size(); ++i) {
-        auto& node = m_sortedNodes [i];
+    auto&     frame          = m_frames [m_renderer->getFrameIndex()];
+    auto&     uploader       = m_renderer->getUploader();
+    const u32 viewDataOffset = m_renderer->getFrameAllocator().push(m_camera->getViewData());
+
+    // Uploads recorded meanwhile only wait for the earlier nodes touching their destination, see addUploadWaits
+    frame.frameNumber = ++m_frameNumber;
+    record(frame, viewDataOffset);
+
+    // Copies recorded by the nodes have to be on their way before the nodes' work waits on them
+    uploader.flush();
+
+    assignTimelineValues(frame);
+    if (!frame.compiledNodes.empty()) {
+        recordPrologues(frame);
+    }
+    submit(frame);
+}
+
+void RenderGraph::record(FrameResources& frame, u32 viewDataOffset) {
+    ZoneScoped;
+    const IRenderingNode::ExecutionData executionData {m_frameBufferIndex, m_camera, viewDataOffset, m_frameNumber};
+    for (const auto& compiled : frame.compiledNodes) {
+        m_recordingNode = compiled.node;
+        compiled.node->prepareExecution(executionData);
+    }
+    m_recordingNode = nullptr;
+
+    auto recordNode = [this, &executionData](CompiledNode& compiled)
+    {
+        auto*                    staticCommandBuffer = compiled.staticCommandBuffer;
+        const std::optional<u64> staticVersion       = staticCommandBuffer ? compiled.node->getStaticVersion() : std::nullopt;
+        compiled.reusedRecording                     = staticVersion && staticCommandBuffer->version == staticVersion;
+        if (compiled.reusedRecording) {
+            compiled.waitStages       = staticCommandBuffer->waitStages;
+            compiled.uploadDependency = staticCommandBuffer->uploadDependency;
+            compiled.recordMs         = 0.0f;
+            return;
+        }
+
+        const auto recordStart     = std::chrono::steady_clock::now();
+        const auto executionResult = compiled.node->execute(executionData, *compiled.commandBuffer);
+        assert(*executionResult.queue == *getQueue(compiled.queue));
+        compiled.waitStages = executionResult.flags == vk::PipelineStageFlagBits::eNone ? vk::PipelineStageFlagBits::eAllCommands : executionResult.flags;
+        compiled.uploadDependency = executionResult.uploadDependency;
+        compiled.recordMs         = std::chrono::duration_cast<TimeSpan>(std::chrono::steady_clock::now() - recordStart).count();
+
+        // Execute may have changed the version, e.g. by recreating the pipeline
+        if (staticCommandBuffer) {
+            staticCommandBuffer->version          = compiled.node->getStaticVersion();
+            staticCommandBuffer->waitStages       = compiled.waitStages;
+            staticCommandBuffer->uploadDependency = compiled.uploadDependency;
+        }
+    };
+
+    // Each lane only writes the compiled nodes it records, the submission order stays the registration order
+    std::vector<std::future<void>> lanes;
+    for (u32 lane = 0u; lane < frame.lanes.size(); ++lane) {
+        if (std::ranges::none_of(frame.compiledNodes, [lane](const CompiledNode& compiled) { return compiled.lane == lane; })) {
+            continue;
+        }
+        lanes.emplace_back(m_jobSystem->schedule(
+          [&frame, &recordNode, lane]()
+          {
+              ZoneScopedN("Record Lane");
+              for (auto& compiled : frame.compiledNodes) {
+                  if (compiled.lane == lane) {
+                      recordNode(compiled);
+                  }
+              }
+          }));
+    }
+
+    // Only nodes on the main thread upload, the uploader isn't thread safe
+    for (auto& compiled : frame.compiledNodes) {
+        if (!compiled.lane) {
+            m_recordingNode = compiled.node;
+            recordNode(compiled);
+        }
+    }
+    m_recordingNode = nullptr;
+    for (auto& lane : lanes) {
+        lane.get();
+    }
+    TracyPlot("Render Graph Recording Lanes", static_cast<i64>(lanes.size()));
+    TracyPlot("Render Graph Reused Recordings", static_cast<i64>(std::ranges::count(frame.compiledNodes, true, &CompiledNode::reusedRecording)));
+}
+
+u32 RenderGraph::getHistoryIndex(const Resource& resource) const {
+    const auto* buffer = std::get_if<GlobalBuffers>(&resource);
+    return buffer && m_renderer->isPerFrameInFlight(*buffer) ? m_renderer->getFrameIndex() : 0u;
+}
+
+void RenderGraph::assignTimelineValues(FrameResources& frame) {
+    // Earlier frames are only waited on where they touched the same resources, or ran the same node
+    for (auto& compiled : frame.compiledNodes) {
+        auto& waits = compiled.previousFrameWaits;
+        waits       = {};
+        if (const auto it = m_nodeHistory.find(compiled.node); it != m_nodeHistory.end()) {
+            waits [it->second.first] = it->second.second;
+        }
+        for (const auto& usage : compiled.usages) {
+            const auto it = m_resourceHistory.find(usage.resource);
+            if (it == m_resourceHistory.end()) {
+                continue;
+            }
+            const auto& history = it->second [getHistoryIndex(usage.resource)];
+            for (u32 queue = 0u; queue < QueueCount; ++queue) {
+                const u64 lastRead = usage.write ? history.lastRead [queue] : 0u;
+                waits [queue]      = std::max({waits [queue], history.lastWrite [queue], lastRead});
+            }
+        }
+    }
+
+    frame.previousFrameStart = m_frameStartValues;
+    frame.previousFrameEnd   = m_timelineValues;
+    m_frameStartValues       = m_timelineValues;
+    for (auto& compiled : frame.compiledNodes) {
+        compiled.timelineValue        = ++m_timelineValues [compiled.queue];
+        m_nodeHistory [compiled.node] = {compiled.queue, compiled.timelineValue};
+        for (const auto& usage : compiled.usages) {
+            auto& history                                                          = m_resourceHistory [usage.resource][getHistoryIndex(usage.resource)];
+            (usage.write ? history.lastWrite : history.lastRead) [compiled.queue] = compiled.timelineValue;
+        }
+    }
+}
+
+void RenderGraph::addUploadWaits(vk::Buffer destination, std::vector<StagingUploader::TimelineWait>& waits) const {
+    // Only earlier frames are in the histories, the nodes of this frame wait for the upload themselves
+    TimelineValues values {};
+    bool           known = false;
+    for (u32 i = 0u; i < static_cast<u32>(GlobalBuffers::Undefined) && !known; ++i) {
+        const auto identifier = static_cast<GlobalBuffers>(i);
+        for (u32 frameIndex = 0u; frameIndex < Renderer::maxFramesInFlight && !known; ++frameIndex) {
+            const auto* buffer = m_renderer->getGlobalBuffer(identifier, frameIndex);
+            if (!buffer || **buffer != destination) {
+                continue;
+            }
+            known = true;
+            if (const auto it = m_resourceHistory.find(Resource {identifier}); it != m_resourceHistory.end()) {
+                const auto& history = it->second [m_renderer->isPerFrameInFlight(identifier) ? frameIndex : 0u];
+                for (u32 queue = 0u; queue < QueueCount; ++queue) {
+                    values [queue] = std::max(history.lastWrite [queue], history.lastRead [queue]);
+                }
+            }
+        }
+    }
+    // Nodes may read what they don't declare, so the uploading node's own last execution is waited for as well
+    if (m_recordingNode) {
+        known = true;
+        if (const auto it = m_nodeHistory.find(m_recordingNode); it != m_nodeHistory.end()) {
+            values [it->second.first] = std::max(values [it->second.first], it->second.second);
+        }
+    }
+    if (!known) {
+        // Nothing tells who reads the destination, so all work submitted so far is waited for
+        values = m_timelineValues;
+    }
 
-        IRenderingNode::ExecutionData executionData {m_frameBufferIndex, m_camera};
-        auto                          executionResult = node.node->execute(executionData, node.commandBuffer);
+    for (u32 queue = 0u; queue < QueueCount; ++queue) {
+        if (values [queue] != 0u) {
+            waits.push_back(StagingUploader::TimelineWait {*m_timelines [queue], values [queue]});
+        }
+    }
+}
+
+void RenderGraph::recordPrologues(FrameResources& frame) const {
+    ZoneScoped;
+    const u32 nodeCount = static_cast<u32>(frame.compiledNodes.size());
+    for (u32 i = 0u; i < nodeCount; ++i) {
+        auto&       compiled  = frame.compiledNodes [i];
+        const auto& resources = frame.nodeResources [i];
+
+        // Nodes on another queue are waited on through their timeline
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::MemoryBarrier      barrier;
+        for (const auto& dependency : compiled.dependencies) {
+            if (*getQueue(frame.compiledNodes [dependency.source].queue) == *getQueue(compiled.queue)) {
+                srcStages |= dependency.srcStages;
+                dstStages |= dependency.dstStages;
+                barrier.srcAccessMask |= dependency.srcAccess;
+                barrier.dstAccessMask |= dependency.dstAccess;
+            }
+        }
+        compiled.barrier = static_cast<bool>(srcStages);
+        if (!compiled.barrier && !m_timestampsSupported) {
+            continue;
+        }
+
+        resources.prologueCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        if (m_timestampsSupported) {
+            resources.prologueCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *frame.timestampPool, 2u * i);
+        }
+        if (compiled.barrier) {
+            resources.prologueCommandBuffer.pipelineBarrier(srcStages, dstStages, {}, barrier, nullptr, nullptr);
+        }
+        resources.prologueCommandBuffer.end();
+
+        if (m_timestampsSupported) {
+            resources.epilogueCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            resources.epilogueCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *frame.timestampPool, 2u * i + 1u);
+            resources.epilogueCommandBuffer.end();
+        }
+    }
+    frame.timestampsWritten = m_timestampsSupported;
+}
+
+void RenderGraph::submit(const FrameResources& frame) const {
+    ZoneScoped;
+    const auto  submitStart   = std::chrono::steady_clock::now();
+    const auto& uploader      = m_renderer->getUploader();
+    const auto& graphicsQueue = m_renderer->getGraphicsQueue();
+    const u32   nodeCount     = static_cast<u32>(frame.compiledNodes.size());
+
+    std::vector<NodeSubmission> submissions(nodeCount);
+    std::optional<u32>          imageAcquireNode;
+    std::optional<u32>          lastGraphicsNode;
+    for (u32 i = 0u; i < nodeCount; ++i) {
+        const auto& compiled   = frame.compiledNodes [i];
+        const auto& resources  = frame.nodeResources [i];
+        auto&       submission = submissions [i];
+        submission.queue       = *getQueue(compiled.queue);
+
+        TimelineValues         dependencyWaits {};
+        vk::PipelineStageFlags dependencyStages = compiled.waitStages;
+        for (const auto& dependency : compiled.dependencies) {
+            const auto& source = frame.compiledNodes [dependency.source];
+            if (*getQueue(source.queue) != submission.queue) {
+                dependencyWaits [source.queue] = std::max(dependencyWaits [source.queue], source.timelineValue);
+                dependencyStages |= dependency.dstStages;
+            }
+        }
+        for (u32 queue = 0u; queue < QueueCount; ++queue) {
+            const u64 value = std::max(compiled.previousFrameWaits [queue], dependencyWaits [queue]);
+            if (value == 0u) {
+                continue;
+            }
+            // Earlier frames may have touched what the node doesn't declare, so those are waited on from the first command
+            const bool earlierFrame = compiled.previousFrameWaits [queue] >= dependencyWaits [queue];
+            const auto stages       = earlierFrame ? vk::PipelineStageFlagBits2::eAllCommands : toStageFlags2(dependencyStages);
+            submission.waits.emplace_back(*m_timelines [queue], value, stages);
+        }
+        if (!uploader.isComplete(compiled.uploadDependency)) {
+            // Nodes may consume uploads before the stage they report, e.g. by blitting from them
+            submission.waits.emplace_back(*uploader.getTimelineSemaphore(), compiled.uploadDependency.value, vk::PipelineStageFlagBits2::eAllCommands);
+        }
 
-        vk::ArrayProxyNoTemporaries<const vk::Semaphore> array;
-        if (i != 0) {
-            array = *m_sortedNodes [i - 1].semaphore;
+        // A semaphore wait only covers the commands of its own submission, so the first node writing the swap chain waits for the acquire
+        const bool writesSwapChain = std::ranges::any_of(
+          compiled.usages, [](const ResourceUsage& usage) { return usage.write && usage.resource == Resource {Attachment::SwapChain}; });
+        if (!imageAcquireNode && writesSwapChain && submission.queue == *graphicsQueue) {
+            imageAcquireNode = i;
+            submission.waits.emplace_back(*m_renderer->getImageAcquiredSemaphore(), 0u, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+        }
+        if (submission.queue == *graphicsQueue) {
+            lastGraphicsNode = i;
+        }
+
+        if (compiled.barrier || m_timestampsSupported) {
+            submission.commandBuffers.emplace_back(*resources.prologueCommandBuffer);
+        }
+        submission.commandBuffers.emplace_back(**compiled.commandBuffer);
+        if (m_timestampsSupported) {
+            submission.commandBuffers.emplace_back(*resources.epilogueCommandBuffer);
+        }
+        submission.signals.emplace_back(*m_timelines [compiled.queue], compiled.timelineValue, vk::PipelineStageFlagBits2::eAllCommands);
+    }
+
+    // The last graphics node also waits for the compute work, so the draw fence marks the end of the whole frame.
+    // Without any graphics node an empty submission takes its place.
+    if (!lastGraphicsNode) {
+        lastGraphicsNode = static_cast<u32>(submissions.size());
+        submissions.emplace_back().queue = *graphicsQueue;
+    }
+    auto& lastSubmission = submissions [*lastGraphicsNode];
+    if (m_timelineValues [ComputeQueue] != 0u) {
+        lastSubmission.waits.emplace_back(*m_timelines [ComputeQueue], m_timelineValues [ComputeQueue], vk::PipelineStageFlagBits2::eAllCommands);
+    }
+    if (!imageAcquireNode) {
+        lastSubmission.waits.emplace_back(*m_renderer->getImageAcquiredSemaphore(), 0u, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    }
+    lastSubmission.signals.emplace_back(*m_renderer->getRenderFinishedSemaphore(m_frameBufferIndex), 0u, vk::PipelineStageFlagBits2::eAllCommands);
+
+    // All submissions of a queue go into one call, unless every node is submitted on its own for comparison. A node may
+    // wait on a value which is only signaled by a later call on another queue, timeline semaphores allow waiting before the signal.
+    const auto&       drawFence   = m_renderer->getDrawFence();
+    u32               submitCount = 0u;
+    std::vector<bool> submitted(submissions.size(), false);
+    for (u64 i = 0u; i < submissions.size(); ++i) {
+        if (submitted [i]) {
+            continue;
         }
 
-        const vk::SubmitInfo computeInfo {
-          array,
-          executionResult.flags == vk::PipelineStageFlagBits::eNone ? vk::ArrayProxyNoTemporaries<const vk::PipelineStageFlags> {} : executionResult.flags,
-          *node.commandBuffer,
-          *node.semaphore};
-        executionResult.queue.submit(computeInfo);
+        std::vector<vk::SubmitInfo2> submitInfos;
+        bool                         containsLast = false;
+        for (u64 j = i; j < submissions.size(); ++j) {
+            const auto& submission = submissions [j];
+            if (!submitted [j] && submission.queue == submissions [i].queue && (j == i || !m_config->submitPerNode)) {
+                submitInfos.emplace_back(vk::SubmitFlags {}, submission.waits, submission.commandBuffers, submission.signals);
+                submitted [j] = true;
+                containsLast  = containsLast || j == *lastGraphicsNode;
+            }
+        }
+        submissions [i].queue.submit2(submitInfos, containsLast ? *drawFence : vk::Fence {});
+        ++submitCount;
     }
 
-    if (!m_sortedNodes.empty()) {
-        m_renderer->finishDrawFrame(m_sortedNodes [m_sortedNodes.size() - 1].semaphore, m_frameBufferIndex);
+    TracyPlot("Render Graph Queue Submits", static_cast<i64>(submitCount));
+    TracyPlot("Render Graph Submit us", std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - submitStart).count());
+
+    m_renderer->finishDrawFrame(m_frameBufferIndex);
+}
+
+void RenderGraph::dumpCompiledGraph(const FrameResources& frame) const {
+    constexpr std::array<std::string_view, QueueCount> queueNames {"graphics", "compute"};
+
+    std::string dump = std::format("Render graph of frame {}\n", frame.frameNumber);
+    for (const auto& compiled : frame.compiledNodes) {
+        dump += std::format(
+          "  {:<8} {:<24} record {:6.3f} ms on {:<6} gpu {:6.3f} ms{}\n",
+          queueNames [compiled.queue],
+          compiled.node->getName(),
+          compiled.recordMs,
+          compiled.lane ? "worker" : "main",
+          compiled.gpuMs,
+          compiled.reusedRecording ? ", reused recording" : "");
+        for (const auto& dependency : compiled.dependencies) {
+            const auto& source = frame.compiledNodes [dependency.source];
+            dump += std::format(
+              "    after {} ({}): {} -> {}\n",
+              source.node->getName(),
+              *getQueue(source.queue) == *getQueue(compiled.queue) ? "barrier" : "timeline",
+              vk::to_string(dependency.srcStages),
+              vk::to_string(dependency.dstStages));
+        }
+        for (u32 queue = 0u; queue < QueueCount; ++queue) {
+            if (compiled.previousFrameWaits [queue] != 0u) {
+                dump += std::format("    after {} timeline value {} of an earlier frame\n", queueNames [queue], compiled.previousFrameWaits [queue]);
+            }
+        }
+        // Work of the previous frame on the other queue which the node doesn't wait for may still run next to it
+        for (u32 queue = 0u; queue < QueueCount; ++queue) {
+            const u64 overlapStart = std::max(compiled.previousFrameWaits [queue], frame.previousFrameStart [queue]) + 1u;
+            if (queue != compiled.queue && overlapStart <= frame.previousFrameEnd [queue]) {
+                dump += std::format(
+                  "    overlaps {} timeline values {} to {} of the previous frame\n", queueNames [queue], overlapStart, frame.previousFrameEnd [queue]);
+            }
+        }
+    }
+    for (const auto name : frame.culledNodes) {
+        dump += std::format("  culled {}\n", name);
     }
+    std::cout << dump;
 }
 }   // namespace dnm
@@ -1,21 +1,35 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <vulkan/vulkan_raii.hpp>
 
+#include <Core/Config.hpp>
+#include <Core/JobSystem.hpp>
 #include <Core/ShortTypes.hpp>
 
+#include <Rendering/Renderer.hpp>
+#include <RenderingNodes/IRenderingNode.hpp>
+
 namespace dnm
 {
 class Camera;
-class Renderer;
-class IRenderingNode;
 
+// Nodes declare the global buffers and attachments they read and write. The graph keeps them in registration order,
+// culls the ones whose writes are never read and separates the nodes on the same queue by barriers. Every node signals
+// the timeline of its queue, nodes on the other queue and the nodes of later frames wait on the values they depend on.
+// Global buffers which are kept per frame in flight only tie together the frames using the same copy.
+// All nodes of a queue are submitted at once. Nodes with a static version keep their recordings across frames.
 class RenderGraph {
     public:
-    explicit RenderGraph(Renderer* renderer, Camera* camera);
+    explicit RenderGraph(Config* config, Renderer* renderer, Camera* camera, JobSystem* jobSystem);
+    ~RenderGraph();
 
     void registerNode(std::unique_ptr<IRenderingNode> node);
 
@@ -24,19 +38,171 @@ class RenderGraph {
     void execute();
 
     private:
+    using Resource = decltype(ResourceUsage::resource);
+
+    enum QueueIndex : u32
+    {
+        GraphicsQueue,
+        ComputeQueue,
+        QueueCount
+    };
+    using TimelineValues = std::array<u64, QueueCount>;
+
+    // The node has to wait for the source node, on the same queue through a barrier and otherwise through its timeline
+    struct Dependency
+    {
+        u32                    source;
+        vk::PipelineStageFlags srcStages;
+        vk::AccessFlags        srcAccess;
+        vk::PipelineStageFlags dstStages;
+        vk::AccessFlags        dstAccess;
+    };
+
+    // Recording of a node with a static version for one frame in flight and swap chain image
+    struct StaticCommandBuffer
+    {
+        vk::raii::CommandBuffer commandBuffer {nullptr};
+        std::optional<u64>      version;
+        // What execute returned when it was recorded
+        vk::PipelineStageFlags  waitStages;
+        UploadToken             uploadDependency {};
+    };
+
+    struct CompiledNode
+    {
+        IRenderingNode*            node = nullptr;
+        std::vector<ResourceUsage> usages;
+        std::vector<Dependency>    dependencies;
+        QueueIndex                 queue = GraphicsQueue;
+
+        // Nodes recorded in parallel use a command buffer of their lane's pool, nodes with a static version their own
+        std::optional<u32>       lane;
+        vk::raii::CommandBuffer* commandBuffer       = nullptr;
+        StaticCommandBuffer*     staticCommandBuffer = nullptr;
+
+        // Known once the node was recorded
+        vk::PipelineStageFlags waitStages;
+        UploadToken            uploadDependency {};
+        // Values of earlier frames the node has to wait for and the value it signals itself
+        TimelineValues         previousFrameWaits {};
+        u64                    timelineValue   = 0u;
+        bool                   barrier         = false;
+        bool                   reusedRecording = false;
+        float                  recordMs        = 0.0f;
+        float                  gpuMs           = 0.0f;
+    };
+
+    // Reused by whichever node executes at the same position of a later frame, reallocated if its queue family changes
+    struct NodeResources
+    {
+        vk::raii::CommandBuffer commandBuffer {nullptr};
+        // Barriers towards the previous nodes of the queue and the node's start timestamp
+        vk::raii::CommandBuffer prologueCommandBuffer {nullptr};
+        // The node's end timestamp
+        vk::raii::CommandBuffer epilogueCommandBuffer {nullptr};
+        u32                     family     = ~0u;
+        IRenderingNode*         markedNode = nullptr;
+    };
+
+    // Records its nodes on one worker, command pools must not be used by several threads at once
+    struct RecordingLane
+    {
+        vk::raii::CommandPool                commandPool {nullptr};
+        std::vector<vk::raii::CommandBuffer> commandBuffers;
+        std::vector<IRenderingNode*>         markedNodes;
+    };
+
+    // Only reset once the fence of the frame in flight was waited on
+    struct FrameResources
+    {
+        // The compute pool is only created for a dedicated compute family
+        vk::raii::CommandPool         graphicsCommandPool {nullptr};
+        vk::raii::CommandPool         computeCommandPool {nullptr};
+        std::vector<RecordingLane>    lanes;
+        vk::raii::QueryPool           timestampPool {nullptr};
+        std::vector<NodeResources>    nodeResources;
+        std::vector<CompiledNode>     compiledNodes;
+        std::vector<std::string_view> culledNodes;
+        // Values before the first and after the last node of the previous frame, the same if it had no node on the queue
+        TimelineValues                previousFrameStart {};
+        TimelineValues                previousFrameEnd {};
+        u64                           frameNumber       = 0u;
+        bool                          timestampsWritten = false;
+    };
+
+    // Lives as long as the graph, its command buffers are only reset when they are recorded again
+    struct StaticRecording
+    {
+        vk::raii::CommandPool commandPool {nullptr};
+        u32                   family           = ~0u;
+        u32                   swapChainVersion = 0u;
+        // Indexed by the frame in flight and the swap chain image
+        std::array<std::vector<StaticCommandBuffer>, Renderer::maxFramesInFlight> commandBuffers;
+    };
+
+    // Values of the last nodes of earlier frames which wrote or read a resource
+    struct ResourceHistory
+    {
+        TimelineValues lastWrite {};
+        TimelineValues lastRead {};
+    };
+    // Global buffers kept per frame in flight have a history per copy, everything else only uses the first
+    using ResourceHistories = std::array<ResourceHistory, Renderer::maxFramesInFlight>;
+
+    void compile(FrameResources& frame) const;
+    void assignCommandBuffers(FrameResources& frame);
+    void record(FrameResources& frame, u32 viewDataOffset);
+    void assignTimelineValues(FrameResources& frame);
+    void readTimestamps(FrameResources& frame) const;
+    void recordPrologues(FrameResources& frame) const;
+    void submit(const FrameResources& frame) const;
+    void dumpCompiledGraph(const FrameResources& frame) const;
+    // Copy of the resource the current frame in flight uses
+    u32  getHistoryIndex(const Resource& resource) const;
+    // Waits of an upload into the destination for the nodes of earlier frames which still read or write it
+    void addUploadWaits(vk::Buffer destination, std::vector<StagingUploader::TimelineWait>& waits) const;
+
+    const vk::raii::Queue& getQueue(QueueIndex queue) const;
+    vk::raii::CommandPool& getCommandPool(FrameResources& frame, QueueIndex queue);
+    StaticCommandBuffer&   getStaticCommandBuffer(const IRenderingNode* node, u32 family);
+
+    Config*   m_config {nullptr};
     Renderer* m_renderer {nullptr};
     Camera*   m_camera {nullptr};
 
     std::vector<std::unique_ptr<IRenderingNode>> m_nodes;
 
-    struct SortedNode
-    {
-        vk::raii::Semaphore     semaphore;
-        vk::raii::CommandBuffer commandBuffer;
-        IRenderingNode*         node;
-    };
+    std::array<FrameResources, Renderer::maxFramesInFlight> m_frames;
+    u32                                                     m_frameBufferIndex;
+    // Vulkan objects created by the graph in the last build, zero once every frame in flight was built with the same nodes
+    u32                                                     m_createdObjects = 0u;
+
+    // Nodes of the last build with their queue and whether they are recorded statically. A frame in flight which was
+    // already built with the same nodes and swap chain must not create anything.
+    using NodeSetEntry = std::tuple<const IRenderingNode*, QueueIndex, bool>;
+    std::vector<NodeSetEntry>                     m_builtNodeSet;
+    u32                                           m_builtSwapChainVersion = 0u;
+    std::array<bool, Renderer::maxFramesInFlight> m_builtWithNodeSet {};
+
+    // The graph adds one worker per lane to the job system, the main thread records the other nodes meanwhile
+    JobSystem* m_jobSystem {nullptr};
+    u32        m_laneCount = 0u;
+
+    std::unordered_map<const IRenderingNode*, StaticRecording> m_staticRecordings;
+
+    bool  m_timestampsSupported = false;
+    float m_timestampPeriod     = 1.0f;
 
-    std::vector<SortedNode> m_sortedNodes;
-    u32                     m_frameBufferIndex;
+    // Without a dedicated compute family both timelines are signaled on the graphics queue
+    std::array<vk::raii::Semaphore, QueueCount>                           m_timelines {vk::raii::Semaphore {nullptr}, vk::raii::Semaphore {nullptr}};
+    TimelineValues                                                        m_timelineValues {};
+    // Values before the first node of the last frame
+    TimelineValues                                                        m_frameStartValues {};
+    std::unordered_map<Resource, ResourceHistories>                       m_resourceHistory;
+    // Nodes may touch resources they don't declare, so each node also waits for its own last execution
+    std::unordered_map<const IRenderingNode*, std::pair<QueueIndex, u64>> m_nodeHistory;
+    u64                                                                   m_frameNumber = 0u;
+    // Node the main thread prepares or records, buffers which aren't global belong to the node uploading into them
+    const IRenderingNode*                                                 m_recordingNode = nullptr;
 };
-}   // namespace dnm
\ No newline at end of file
+}   // namespace dnm
@@ -4,6 +4,10 @@
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 #endif
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
 #include <Core/Math.hpp>
 #include <Core/Profiler.hpp>
 #include <Core/ShortTypes.hpp>
@@ -12,8 +16,43 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 namespace dnm
 {
+namespace
+{
+    constexpr vk::DeviceSize stagingRingCapacity     = 64u * 1024u * 1024u;
+    constexpr vk::DeviceSize frameAllocatorRegionSize = 2u * 1024u * 1024u;
+
+    constexpr std::string_view pipelineCacheFile = "PipelineCache.bin";
+
+    // Only data of the same device and driver is handed to the driver, not every driver rejects foreign data itself
+    std::vector<u8> readPipelineCache(const vk::PhysicalDeviceProperties& properties) {
+        std::ifstream file(pipelineCacheFile.data(), std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return {};
+        }
+        std::vector<u8> data(static_cast<u64>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        vk::PipelineCacheHeaderVersionOne header;
+        if (!file || data.size() < sizeof(header)) {
+            std::cout << "Ignoring the pipeline cache, it is truncated.\n";
+            return {};
+        }
+        memcpy(&header, data.data(), sizeof(header));
+
+        const bool matches = header.headerSize >= sizeof(header) && header.headerVersion == vk::PipelineCacheHeaderVersion::eOne &&
+                             header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                             header.pipelineCacheUUID == properties.pipelineCacheUUID;
+        if (!matches) {
+            std::cout << "Ignoring the pipeline cache, it was written by another device or driver.\n";
+            return {};
+        }
+        return data;
+    }
+}   // namespace
+
 Renderer::Renderer(Config* config) : m_config {config} {
-    m_instance = makeInstance(m_context, "Definitely not Minecraft", "EngineName", {}, getInstanceExtensions(), VK_API_VERSION_1_2);
+    m_instance = makeInstance(m_context, "Definitely not Minecraft", "EngineName", {}, getInstanceExtensions(), VK_API_VERSION_1_3);
 #if !defined(NDEBUG)
     vk::raii::DebugUtilsMessengerEXT debugUtilsMessenger(m_instance, makeDebugUtilsMessengerCreateInfoEXT());
 #endif
@@ -21,20 +60,40 @@ Renderer::Renderer(Config* config) : m_config {config} {
 
     std::vector<vk::ExtensionProperties> extensionProperties = m_physicalDevice.enumerateDeviceExtensionProperties();
 
-    auto supportedFeatures =
-      m_physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan11Features, vk::PhysicalDeviceVulkan12Features>();
+    auto supportedFeatures = m_physicalDevice.getFeatures2<
+      vk::PhysicalDeviceFeatures2,
+      vk::PhysicalDeviceVulkan11Features,
+      vk::PhysicalDeviceVulkan12Features,
+      vk::PhysicalDeviceVulkan13Features>();
+    // The render graph submits every frame with vkQueueSubmit2
+    if (!supportedFeatures.get<vk::PhysicalDeviceVulkan13Features>().synchronization2) {
+        throw std::runtime_error("The device does not support synchronization2 -> terminating");
+    }
 
     m_surfaceData = SurfaceData(m_instance, "Definitely not Minecraft", vk::Extent2D(1920, 1017));
 
     std::pair<u32, u32> graphicsAndPresentQueueFamilyIndex = findGraphicsAndPresentQueueFamilyIndex(m_physicalDevice, m_surfaceData.surface);
-    m_device                                               = makeDevice(
+    const u32 transferQueueFamilyIndex = findDedicatedTransferQueueFamilyIndex(m_physicalDevice).value_or(graphicsAndPresentQueueFamilyIndex.first);
+    // Without an async compute family the compute work shares the graphics queue
+    const u32 computeQueueFamilyIndex = findAsyncComputeQueueFamilyIndex(m_physicalDevice).value_or(graphicsAndPresentQueueFamilyIndex.first);
+    m_familyIndices                   = FamilyIndices {
+      graphicsAndPresentQueueFamilyIndex.first, graphicsAndPresentQueueFamilyIndex.second, transferQueueFamilyIndex, computeQueueFamilyIndex};
+
+    std::array queueFamilyIndices {
+      m_familyIndices.graphicsQueueFamilyIndex,
+      m_familyIndices.presentQueueFamilyIndex,
+      m_familyIndices.transferQueueFamilyIndex,
+      m_familyIndices.computeQueueFamilyIndex};
+    m_device = makeDevice(
       m_physicalDevice,
-      graphicsAndPresentQueueFamilyIndex.first,
+      queueFamilyIndices,
       getDeviceExtensions(),
       &supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features,
       &supportedFeatures.get<vk::PhysicalDeviceVulkan11Features>());
     registerDebugMarker(m_device, "DNM Device");
 
+    m_memoryAllocator = std::make_unique<DeviceMemoryAllocator>(m_physicalDevice, m_device, maxFramesInFlight);
+
     m_commandPool = vk::raii::CommandPool(m_device, {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsAndPresentQueueFamilyIndex.first});
 
     std::array sizes {
@@ -54,38 +113,82 @@ Renderer::Renderer(Config* config) : m_config {config} {
     m_descriptorPool = makeDescriptorPool(m_device, sizes);
 
     m_graphicsQueue = vk::raii::Queue(m_device, graphicsAndPresentQueueFamilyIndex.first, 0);
-    m_computeQueue  = vk::raii::Queue(m_device, graphicsAndPresentQueueFamilyIndex.first, 0);
+    m_computeQueue  = vk::raii::Queue(m_device, computeQueueFamilyIndex, 0);
     m_presentQueue  = vk::raii::Queue(m_device, graphicsAndPresentQueueFamilyIndex.second, 0);
+    m_transferQueue = vk::raii::Queue(m_device, transferQueueFamilyIndex, 0);
+
+    for (const u32 family : {m_familyIndices.graphicsQueueFamilyIndex, transferQueueFamilyIndex, computeQueueFamilyIndex}) {
+        if (std::ranges::find(m_sharingFamilies, family) == m_sharingFamilies.end()) {
+            m_sharingFamilies.push_back(family);
+        }
+    }
+    m_uploader       = std::make_unique<StagingUploader>(*m_memoryAllocator, m_transferQueue, transferQueueFamilyIndex, stagingRingCapacity);
+    m_frameAllocator = std::make_unique<FrameAllocator>(*m_memoryAllocator, frameAllocatorRegionSize, maxFramesInFlight, m_sharingFamilies);
 
-    m_pipelineCache = vk::raii::PipelineCache(m_device, vk::PipelineCacheCreateInfo());
+    const std::vector<u8> pipelineCacheData = readPipelineCache(m_physicalDevice.getProperties());
+    m_pipelineCache          = vk::raii::PipelineCache(m_device, vk::PipelineCacheCreateInfo({}, pipelineCacheData.size(), pipelineCacheData.data()));
+    m_pipelineCacheWarm      = !pipelineCacheData.empty();
+    m_savedPipelineCacheSize = pipelineCacheData.size();
 
     m_projection                 = createBuffer(sizeof(m4), vk::BufferUsageFlagBits::eUniformBuffer, "Projection Matrix");
     m_projectionClipRegistration = registerRAIIBuffer(GlobalBuffers::ProjectionClip, m_projection);
 
     recreateSwapChain();
 
-    m_drawFence              = vk::raii::Fence(m_device, {vk::FenceCreateFlagBits::eSignaled});
-    m_imageAcquiredSemaphore = vk::raii::Semaphore(m_device, vk::SemaphoreCreateInfo());
+    for (u32 i = 0u; i < maxFramesInFlight; ++i) {
+        m_drawFences.emplace_back(m_device, vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+        m_imageAcquiredSemaphores.emplace_back(m_device, vk::SemaphoreCreateInfo());
+        registerDebugMarker(m_device, m_imageAcquiredSemaphores.back(), "Image Acquired");
+    }
+    m_frameStart = std::chrono::steady_clock::now();
 }
 
 Renderer::~Renderer() {
     m_device.waitIdle();
+    savePipelineCache();
+    m_frameAllocator.reset();
+    m_uploader.reset();
 }
 
 u32 Renderer::prepareDrawFrame() {
     ZoneScoped;
+    const auto& drawFence = m_drawFences [m_frameIndex];
+    const auto  waitStart = std::chrono::steady_clock::now();
     {
         ZoneScopedN("Wait on fence");
-        while (vk::Result::eTimeout == m_device.waitForFences({*m_drawFence}, VK_TRUE, FenceTimeout))
+        while (vk::Result::eTimeout == m_device.waitForFences({*drawFence}, VK_TRUE, FenceTimeout))
             ;
     }
+    // The CPU only blocks here once it ran ahead by all frames in flight, the rest of the frame overlaps with the GPU
+    m_recordStart            = std::chrono::steady_clock::now();
+    const TimeSpan frameTime = std::chrono::duration_cast<TimeSpan>(m_recordStart - m_frameStart);
+    const TimeSpan fenceWait = std::chrono::duration_cast<TimeSpan>(m_recordStart - waitStart);
+    m_frameStart             = m_recordStart;
+    TracyPlot("Frame Time ms", frameTime.count());
+    TracyPlot("Fence Wait ms", fenceWait.count());
+    TracyPlot("CPU GPU Overlap %", frameTime.count() > 0.0f ? 100.0 * (1.0 - fenceWait.count() / frameTime.count()) : 0.0);
+
+    if (m_pipelineCacheDirty) {
+        savePipelineCache();
+    }
+
+    // Everything the GPU read from this frame's region is done now
+    m_frameAllocator->beginFrame(m_frameIndex);
+    m_memoryAllocator->beginFrame(m_frameIndex);
+    // Frames in flight dropped by lowering the count are never waited on again
+    for (u32 i = getFramesInFlight(); i < maxFramesInFlight; ++i) {
+        if (m_drawFences [i].getStatus() == vk::Result::eSuccess) {
+            m_memoryAllocator->releaseDeferredFrees(i);
+        }
+    }
+    m_memoryAllocator->plotStats();
 
     // Get the index of the next available swapchain image:
     vk::Result result;
     u32        imageIndex;
     {
         ZoneScopedN("Acquire next image");
-        std::tie(result, imageIndex) = m_swapChainData.swapChain.acquireNextImage(FenceTimeout, *m_imageAcquiredSemaphore);
+        std::tie(result, imageIndex) = m_swapChainData.swapChain.acquireNextImage(FenceTimeout, *m_imageAcquiredSemaphores [m_frameIndex]);
     }
 
     if (result == vk::Result::eErrorOutOfDateKHR) {
@@ -96,21 +199,19 @@ u32 Renderer::prepareDrawFrame() {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
     assert(imageIndex < m_swapChainData.images.size());
-    m_drawFence = vk::raii::Fence(m_device, vk::FenceCreateInfo());
+    m_device.resetFences({*drawFence});
 
     return imageIndex;
 }
 
-void Renderer::finishDrawFrame(vk::raii::Semaphore& finishedRendering, u32 imageIndex) {
+void Renderer::finishDrawFrame(u32 imageIndex) {
     ZoneScoped;
-    vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    const std::array       submitInfo = {
-      vk::SubmitInfo {*m_imageAcquiredSemaphore, waitDestinationStageMask},
-       vk::SubmitInfo {       *finishedRendering, waitDestinationStageMask}
-    };
-    m_graphicsQueue.submit(submitInfo, *m_drawFence);
+    TracyPlot("Frame Record ms", std::chrono::duration_cast<TimeSpan>(std::chrono::steady_clock::now() - m_recordStart).count());
 
-    const vk::PresentInfoKHR presentInfoKHR(nullptr, *m_swapChainData.swapChain, imageIndex);
+    const auto& renderFinished = m_renderFinishedSemaphores [imageIndex];
+    m_frameIndex               = (m_frameIndex + 1u) % getFramesInFlight();
+
+    const vk::PresentInfoKHR presentInfoKHR(*renderFinished, *m_swapChainData.swapChain, imageIndex);
 
     const vk::Result result = m_presentQueue.presentKHR(presentInfoKHR);
     switch (result) {
@@ -150,6 +251,14 @@ const vk::raii::PipelineCache& Renderer::getPipelineCache() const {
     return m_pipelineCache;
 }
 
+bool Renderer::isPipelineCacheWarm() const {
+    return m_pipelineCacheWarm;
+}
+
+void Renderer::markPipelineCacheDirty() {
+    m_pipelineCacheDirty = true;
+}
+
 const vk::raii::RenderPass& Renderer::getRenderPass() const {
     return m_renderPass;
 }
@@ -162,10 +271,22 @@ const vk::raii::Queue& Renderer::getGraphicsQueue() const {
     return m_graphicsQueue;
 }
 
+const vk::raii::Queue& Renderer::getTransferQueue() const {
+    return m_transferQueue;
+}
+
 const vk::raii::Framebuffer& Renderer::getFrameBuffer(u32 imageIndex) const {
     return m_framebuffers [imageIndex];
 }
 
+u32 Renderer::getSwapChainVersion() const {
+    return m_swapChainVersion;
+}
+
+u32 Renderer::getSwapChainImageCount() const {
+    return static_cast<u32>(m_swapChainData.images.size());
+}
+
 const vk::raii::DescriptorPool& Renderer::getDescriptorPool() const {
     return m_descriptorPool;
 }
@@ -174,16 +295,57 @@ vk::Format Renderer::getColorFormat() const {
     return m_colorFormat;
 }
 
+const DepthBufferData& Renderer::getDepthBuffer() const {
+    return m_depthBufferData;
+}
+
+const DepthPyramidHeader& Renderer::getDepthPyramidHeader() const {
+    return m_depthPyramidHeader;
+}
+
 Renderer::FamilyIndices Renderer::getIndices() const {
     return m_familyIndices;
 }
 
-vk::raii::CommandBuffer Renderer::getCommandBuffer() const {
-    return makeCommandBuffer(m_device, m_commandPool);
+std::span<const u32> Renderer::getSharingFamilies() const {
+    return m_sharingFamilies;
+}
+
+DeviceMemoryAllocator& Renderer::getMemoryAllocator() const {
+    return *m_memoryAllocator;
+}
+
+StagingUploader& Renderer::getUploader() const {
+    return *m_uploader;
+}
+
+FrameAllocator& Renderer::getFrameAllocator() const {
+    return *m_frameAllocator;
+}
+
+u32 Renderer::getFrameIndex() const {
+    return m_frameIndex;
+}
+
+u32 Renderer::getFramesInFlight() const {
+    return std::clamp(m_config->framesInFlight, 1u, maxFramesInFlight);
+}
+
+const vk::raii::Semaphore& Renderer::getImageAcquiredSemaphore() const {
+    return m_imageAcquiredSemaphores [m_frameIndex];
+}
+
+const vk::raii::Semaphore& Renderer::getRenderFinishedSemaphore(u32 imageIndex) const {
+    return m_renderFinishedSemaphores [imageIndex];
+}
+
+const vk::raii::Fence& Renderer::getDrawFence() const {
+    return m_drawFences [m_frameIndex];
 }
 
 BufferData Renderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags flags, std::string_view debugName, vk::MemoryPropertyFlags propertyFlags) const {
-    auto result = BufferData(m_physicalDevice, m_device, size, flags, propertyFlags);
+    // The staging uploader and the compute queue may touch any buffer next to the graphics queue
+    auto result = BufferData(*m_memoryAllocator, size, flags, propertyFlags, getSharingFamilies());
     registerDebugMarker(m_device, result.buffer, debugName);
     return result;
 }
@@ -196,16 +358,45 @@ std::unique_ptr<BufferRegistration> Renderer::registerRAIIBuffer(
     return std::make_unique<BufferRegistration>(bufferIdentifier, this);
 }
 
+std::unique_ptr<BufferRegistration> Renderer::registerRAIIBuffer(GlobalBuffers bufferIdentifier, const PerFrameBuffers& buffers) {
+    registerBuffer(bufferIdentifier, buffers);
+    return std::make_unique<BufferRegistration>(bufferIdentifier, this);
+}
+
 void Renderer::registerBuffer(GlobalBuffers bufferIdentifier, const BufferData& buffer) {
-    m_globalBuffers [static_cast<u32>(bufferIdentifier)] = &(buffer.buffer);
+    m_globalBuffers [static_cast<u32>(bufferIdentifier)].fill(&(buffer.buffer));
+    m_perFrameGlobalBuffers [static_cast<u32>(bufferIdentifier)] = false;
+    ++m_globalBufferVersion;
+}
+
+void Renderer::registerBuffer(GlobalBuffers bufferIdentifier, const PerFrameBuffers& buffers) {
+    for (u32 i = 0u; i < maxFramesInFlight; ++i) {
+        assert(buffers [i]);
+        m_globalBuffers [static_cast<u32>(bufferIdentifier)][i] = &(buffers [i]->buffer);
+    }
+    m_perFrameGlobalBuffers [static_cast<u32>(bufferIdentifier)] = true;
+    ++m_globalBufferVersion;
 }
 
 void Renderer::removeBufferRegistration(GlobalBuffers bufferIdentifier) {
-    m_globalBuffers [static_cast<u32>(bufferIdentifier)] = nullptr;
+    m_globalBuffers [static_cast<u32>(bufferIdentifier)].fill(nullptr);
+    m_perFrameGlobalBuffers [static_cast<u32>(bufferIdentifier)] = false;
 }
 
 const vk::raii::Buffer* Renderer::getGlobalBuffer(GlobalBuffers bufferIdentifier) const {
-    return m_globalBuffers [static_cast<u32>(bufferIdentifier)];
+    return getGlobalBuffer(bufferIdentifier, m_frameIndex);
+}
+
+const vk::raii::Buffer* Renderer::getGlobalBuffer(GlobalBuffers bufferIdentifier, u32 frameIndex) const {
+    return m_globalBuffers [static_cast<u32>(bufferIdentifier)][frameIndex];
+}
+
+bool Renderer::isPerFrameInFlight(GlobalBuffers bufferIdentifier) const {
+    return m_perFrameGlobalBuffers [static_cast<u32>(bufferIdentifier)];
+}
+
+u32 Renderer::getGlobalBufferVersion() const {
+    return m_globalBufferVersion;
 }
 
 void Renderer::oneTimeSubmit(std::function<void(const vk::raii::CommandBuffer& commandBuffer)> function) const {
@@ -246,14 +437,88 @@ void Renderer::recreateSwapChain() {
       graphicsAndPresentQueueFamilyIndex.first,
       graphicsAndPresentQueueFamilyIndex.second);
 
-    m_depthBufferData = DepthBufferData(m_physicalDevice, m_device, vk::Format::eD32Sfloat, m_surfaceData.extent);
+    m_depthBufferData = DepthBufferData(*m_memoryAllocator, vk::Format::eD32Sfloat, m_surfaceData.extent);
+    recreateDepthPyramid();
 
     m_colorFormat = pickSurfaceFormat(m_physicalDevice.getSurfaceFormatsKHR(*m_surfaceData.surface)).format;
     m_renderPass  = makeRenderPass(m_device, m_colorFormat, m_depthBufferData.format);
 
     m_framebuffers = makeFramebuffers(m_device, m_renderPass, m_swapChainData.imageViews, &m_depthBufferData.imageView, m_surfaceData.extent);
+    ++m_swapChainVersion;
+
+    m_renderFinishedSemaphores.clear();
+    for (u64 i = 0u; i < m_swapChainData.images.size(); ++i) {
+        m_renderFinishedSemaphores.emplace_back(m_device, vk::SemaphoreCreateInfo());
+        registerDebugMarker(m_device, m_renderFinishedSemaphores.back(), "Render Finished");
+    }
+
+    m_projection.write(getProjectionMatrix());
+}
+
+void Renderer::savePipelineCache() {
+    ZoneScoped;
+    m_pipelineCacheDirty = false;
 
-    std::array matrices {getProjectionMatrix()};
-    copyToDevice(m_projection.deviceMemory, std::span<const m4>(matrices));
+    // The cache only grows, recreating pipelines which were already cached doesn't change it
+    const std::vector<u8> data = m_pipelineCache.getData();
+    if (data.size() == m_savedPipelineCacheSize) {
+        return;
+    }
+
+    // Written next to the cache first, so a crash while writing doesn't leave a truncated cache behind
+    const std::string temporaryFile = std::string(pipelineCacheFile) + ".tmp";
+    {
+        std::ofstream file(temporaryFile, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            std::cout << "Failed to write the pipeline cache.\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryFile, pipelineCacheFile, error);
+    if (error) {
+        std::cout << "Failed to replace the pipeline cache: " << error.message() << "\n";
+        return;
+    }
+    m_savedPipelineCacheSize = data.size();
+}
+
+void Renderer::recreateDepthPyramid() {
+    // Level 0 halves the depth buffer, every following level halves the previous one down to a single texel
+    m_depthPyramidHeader = DepthPyramidHeader {.depthSize = glm::uvec2(m_surfaceData.extent.width, m_surfaceData.extent.height)};
+
+    glm::uvec2 levelSize  = m_depthPyramidHeader.depthSize;
+    u32        texelCount = 0u;
+    do {
+        assert(m_depthPyramidHeader.levelCount < maxDepthPyramidLevels);
+        levelSize                                                             = (levelSize + 1u) / 2u;
+        m_depthPyramidHeader.levelOffsets [m_depthPyramidHeader.levelCount++] = texelCount;
+        texelCount += levelSize.x * levelSize.y;
+    } while (levelSize.x > 1u || levelSize.y > 1u);
+
+    // The old registration has to go first, destroying it afterwards would unregister the new buffers
+    m_depthPyramidRegistration.reset();
+    m_depthPyramids.clear();
+    // The registration points into the vector, so it must not grow while it is filled
+    m_depthPyramids.reserve(maxFramesInFlight);
+    PerFrameBuffers depthPyramids {};
+    for (u32 i = 0u; i < maxFramesInFlight; ++i) {
+        depthPyramids [i] = &m_depthPyramids.emplace_back(createBuffer(
+          sizeof(DepthPyramidHeader) + texelCount * sizeof(float),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+          "Depth Pyramid",
+          vk::MemoryPropertyFlagBits::eDeviceLocal));
+    }
+    m_depthPyramidRegistration = registerRAIIBuffer(GlobalBuffers::DepthPyramid, depthPyramids);
+
+    // A zero level count marks a pyramid as not built yet, nothing is occluded until its frame in flight built it
+    oneTimeSubmit(
+      [this](const vk::raii::CommandBuffer& commandBuffer)
+      {
+          for (const auto& depthPyramid : m_depthPyramids) {
+              commandBuffer.fillBuffer(*depthPyramid.buffer, 0u, VK_WHOLE_SIZE, 0u);
+          }
+      });
 }
 }   // namespace dnm
@@ -8,20 +8,37 @@
 #include <Core/Config.hpp>
 #include <Core/GLMInclude.hpp>
 
+#include <Rendering/FrameAllocator.hpp>
 #include <Rendering/GlobalBuffers.hpp>
 #include <Rendering/RAIIUtils.hpp>
+#include <Rendering/StagingUploader.hpp>
 
 namespace dnm
 {
 class ShaderWatcher;
 
+constexpr u32 maxDepthPyramidLevels = 16u;
+
+// Layout of the header of the depthPyramidBuffer in Shaders/DepthPyramid.glsl
+struct DepthPyramidHeader
+{
+    glm::uvec2                             depthSize {};
+    u32                                    levelCount = 0u;
+    u32                                    padding    = 0u;
+    std::array<u32, maxDepthPyramidLevels> levelOffsets {};
+};
+
 class Renderer {
     public:
+    // Per frame resources are sized for this many frames, Config::framesInFlight picks how many are used
+    static constexpr u32 maxFramesInFlight = 3u;
+
     explicit Renderer(Config* config);
     ~Renderer();
 
     u32  prepareDrawFrame();
-    void finishDrawFrame(vk::raii::Semaphore& finishedRendering, u32 imageIndex);
+    // Presents the image, the last submission of the frame has to signal the draw fence and the render finished semaphore
+    void finishDrawFrame(u32 imageIndex);
 
     GLFWwindow*  getGLFWwindow() const;
     vk::Extent2D getExtent() const;
@@ -29,34 +46,71 @@ class Renderer {
     const vk::raii::Instance&       getInstance() const;
     const vk::raii::PhysicalDevice& getPhysicalDevice() const;
     const vk::raii::Device&         getDevice() const;
+    // Loaded from the disk at startup if it was written for the same device and driver
     const vk::raii::PipelineCache&  getPipelineCache() const;
+    bool                            isPipelineCacheWarm() const;
+    // Called after creating pipelines, the cache is written to the disk before the next frame if it grew
+    void                            markPipelineCacheDirty();
     const vk::raii::RenderPass&     getRenderPass() const;
+    // Dedicated async compute queue if the device has one, the graphics queue otherwise
     const vk::raii::Queue&          getComputeQueue() const;
     const vk::raii::Queue&          getGraphicsQueue() const;
+    const vk::raii::Queue&          getTransferQueue() const;
     const vk::raii::Framebuffer&    getFrameBuffer(u32 imageIndex) const;
+    // Bumped whenever the swap chain and its frame buffers are recreated
+    u32                             getSwapChainVersion() const;
+    u32                             getSwapChainImageCount() const;
     const vk::raii::DescriptorPool& getDescriptorPool() const;
 
     vk::Format getColorFormat() const;
 
+    const DepthBufferData&    getDepthBuffer() const;
+    // Layout of the depth pyramids of the current extent, one per frame in flight is registered as GlobalBuffers::DepthPyramid
+    const DepthPyramidHeader& getDepthPyramidHeader() const;
+
     struct FamilyIndices
     {
         u32 graphicsQueueFamilyIndex;
         u32 presentQueueFamilyIndex;
+        u32 transferQueueFamilyIndex;
+        u32 computeQueueFamilyIndex;
     };
 
     FamilyIndices getIndices() const;
 
-    vk::raii::CommandBuffer getCommandBuffer() const;
-    BufferData              createBuffer(
-                   vk::DeviceSize          size,
-                   vk::BufferUsageFlags    flags,
-                   std::string_view        debugName,
-                   vk::MemoryPropertyFlags propertyFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent) const;
+    // Families of the graphics, transfer and compute queue, resources are shared between them
+    std::span<const u32>   getSharingFamilies() const;
+    DeviceMemoryAllocator& getMemoryAllocator() const;
+    StagingUploader&       getUploader() const;
+    FrameAllocator&        getFrameAllocator() const;
+    // Index of the frame in flight which is currently recorded
+    u32                    getFrameIndex() const;
+    u32                    getFramesInFlight() const;
+    // Signaled by the acquire of the swap chain image of the current frame
+    const vk::raii::Semaphore& getImageAcquiredSemaphore() const;
+    const vk::raii::Semaphore& getRenderFinishedSemaphore(u32 imageIndex) const;
+    const vk::raii::Fence&     getDrawFence() const;
+
+    BufferData createBuffer(
+      vk::DeviceSize          size,
+      vk::BufferUsageFlags    flags,
+      std::string_view        debugName,
+      vk::MemoryPropertyFlags propertyFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent) const;
+
+    // Buffers which are rewritten every frame are kept once per frame in flight, so a frame never waits for the earlier ones reading them
+    using PerFrameBuffers = std::array<const BufferData*, maxFramesInFlight>;
 
     std::unique_ptr<BufferRegistration> registerRAIIBuffer(GlobalBuffers bufferIdentifier, const BufferData& buffer);
+    std::unique_ptr<BufferRegistration> registerRAIIBuffer(GlobalBuffers bufferIdentifier, const PerFrameBuffers& buffers);
     void                                registerBuffer(GlobalBuffers bufferIdentifier, const BufferData& buffer);
+    void                                registerBuffer(GlobalBuffers bufferIdentifier, const PerFrameBuffers& buffers);
     void                                removeBufferRegistration(GlobalBuffers bufferIdentifier);
+    // The buffer of the frame in flight which is currently recorded
     const vk::raii::Buffer*             getGlobalBuffer(GlobalBuffers bufferIdentifier) const;
+    const vk::raii::Buffer*             getGlobalBuffer(GlobalBuffers bufferIdentifier, u32 frameIndex) const;
+    bool                                isPerFrameInFlight(GlobalBuffers bufferIdentifier) const;
+    // Bumped whenever a global buffer is (re)registered, so consumers know when their descriptors are stale
+    u32                                 getGlobalBufferVersion() const;
 
     void oneTimeSubmit(std::function<void(const vk::raii::CommandBuffer& commandBuffer)> function) const;
 
@@ -67,6 +121,8 @@ class Renderer {
     private:
     void recreateSwapChainFromWindow();
     void recreateSwapChain();
+    void recreateDepthPyramid();
+    void savePipelineCache();
 
     private:
     Config* m_config;
@@ -77,27 +133,52 @@ class Renderer {
     FamilyIndices                      m_familyIndices;
     SurfaceData                        m_surfaceData {nullptr};
     vk::raii::Device                   m_device {nullptr};
+    // Declared right after the device so every resource allocated from it is gone before it is destroyed
+    std::unique_ptr<DeviceMemoryAllocator> m_memoryAllocator {nullptr};
     vk::raii::CommandPool              m_commandPool {nullptr};
     vk::raii::DescriptorPool           m_descriptorPool {nullptr};
     vk::raii::Queue                    m_computeQueue {nullptr};
     vk::raii::Queue                    m_graphicsQueue {nullptr};
     vk::raii::Queue                    m_presentQueue {nullptr};
+    vk::raii::Queue                    m_transferQueue {nullptr};
+    std::vector<u32>                   m_sharingFamilies;
+    std::unique_ptr<StagingUploader>   m_uploader {nullptr};
+    std::unique_ptr<FrameAllocator>    m_frameAllocator {nullptr};
     SwapChainData                      m_swapChainData {nullptr};
     DepthBufferData                    m_depthBufferData {nullptr};
     vk::raii::RenderPass               m_renderPass {nullptr};
     std::vector<vk::raii::Framebuffer> m_framebuffers;
     vk::raii::PipelineCache            m_pipelineCache {nullptr};
-    vk::raii::Fence                    m_drawFence {nullptr};
-    vk::raii::Semaphore                m_imageAcquiredSemaphore {nullptr};
+    // Indexed by the frame in flight
+    std::vector<vk::raii::Fence>       m_drawFences;
+    std::vector<vk::raii::Semaphore>   m_imageAcquiredSemaphores;
+    // Indexed by the swap chain image, the image may be presented once its frame finished
+    std::vector<vk::raii::Semaphore>   m_renderFinishedSemaphores;
+
+    std::chrono::steady_clock::time_point m_frameStart {};
+    std::chrono::steady_clock::time_point m_recordStart {};
 
     vk::Format m_colorFormat;
+    u32        m_frameIndex          = 0u;
+    u32        m_globalBufferVersion = 0u;
+    u32        m_swapChainVersion    = 0u;
+
+    bool m_pipelineCacheWarm      = false;
+    bool m_pipelineCacheDirty     = false;
+    u64  m_savedPipelineCacheSize = 0u;
 
     // In theory this buffer needs to be a weak ptr to make sure that we notice if
     // something was removed already For my use case, I don't really care add and
     // remove things at runtime
-    std::array<const vk::raii::Buffer*, static_cast<u32>(GlobalBuffers::Undefined)> m_globalBuffers;
+    std::array<std::array<const vk::raii::Buffer*, maxFramesInFlight>, static_cast<u32>(GlobalBuffers::Undefined)> m_globalBuffers {};
+    std::array<bool, static_cast<u32>(GlobalBuffers::Undefined)>                                      m_perFrameGlobalBuffers {};
 
     BufferData                          m_projection {nullptr};
     std::unique_ptr<BufferRegistration> m_projectionClipRegistration {nullptr};
+
+    DepthPyramidHeader                  m_depthPyramidHeader {};
+    // The section culling of a frame reads the pyramid its frame in flight built last, the earlier frames may still build theirs
+    std::vector<BufferData>             m_depthPyramids;
+    std::unique_ptr<BufferRegistration> m_depthPyramidRegistration {nullptr};
 };
 }   // namespace dnm
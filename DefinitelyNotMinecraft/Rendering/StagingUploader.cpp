@@ -0,0 +1,222 @@
+#include "Rendering/StagingUploader.hpp"
+
+#include <algorithm>
+
+#include <Core/Math.hpp>
+#include <Core/Profiler.hpp>
+
+namespace dnm
+{
+namespace
+{
+    // Satisfies the texel size of every format we copy into as well as the buffer offset alignment of copies
+    constexpr vk::DeviceSize stagingAlignment = 16u;
+}   // namespace
+
+StagingUploader::StagingUploader(
+  DeviceMemoryAllocator& allocator,
+  const vk::raii::Queue& queue,
+  u32                    queueFamilyIndex,
+  vk::DeviceSize         capacity) :
+    m_allocator {&allocator}, m_device {&allocator.getDevice()}, m_queue {&queue}, m_capacity {capacity} {
+    const auto& device = allocator.getDevice();
+    m_commandPool = vk::raii::CommandPool(device, {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamilyIndex});
+
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> timelineCreateInfo({}, {vk::SemaphoreType::eTimeline, 0u});
+    m_timelineSemaphore = vk::raii::Semaphore(device, timelineCreateInfo.get<vk::SemaphoreCreateInfo>());
+    registerDebugMarker(device, m_timelineSemaphore, "Staging Upload Timeline");
+
+    m_ringBuffer = BufferData(allocator, capacity, vk::BufferUsageFlagBits::eTransferSrc);
+    registerDebugMarker(device, m_ringBuffer.buffer, "Staging Ring Buffer");
+    m_ringMemory = m_ringBuffer.getMapped();
+}
+
+StagingUploader::~StagingUploader() {
+    flush();
+    if (m_lastSubmittedValue > 0u) {
+        wait(UploadToken {m_lastSubmittedValue});
+    }
+}
+
+UploadToken StagingUploader::upload(const BufferData& destination, std::span<const std::byte> data, vk::DeviceSize destinationOffset) {
+    ZoneScoped;
+    assert(!data.empty());
+
+    const StagingAllocation staging = allocate(data.size_bytes());
+    memcpy(staging.memory, data.data(), data.size_bytes());
+
+    auto& batch = getPendingBatch();
+    batch.commandBuffer.copyBuffer(*staging.buffer, *destination.buffer, vk::BufferCopy(staging.offset, destinationOffset, data.size_bytes()));
+    if (m_waitResolver) {
+        m_waitResolver(*destination.buffer, batch.waits);
+    }
+
+    return UploadToken {m_lastSubmittedValue + 1u};
+}
+
+UploadToken StagingUploader::uploadImage(const ImageData& destination, vk::Extent2D extent, std::span<const std::byte> data) {
+    ZoneScoped;
+    assert(!data.empty());
+
+    const StagingAllocation staging = allocate(data.size_bytes());
+    memcpy(staging.memory, data.data(), data.size_bytes());
+
+    const auto& commandBuffer = getPendingBatch().commandBuffer;
+    setImageLayout(commandBuffer, *destination.image, destination.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+
+    const vk::BufferImageCopy copyRegion(
+      staging.offset,
+      extent.width,
+      extent.height,
+      vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+      vk::Offset3D(0, 0, 0),
+      vk::Extent3D(extent, 1));
+    commandBuffer.copyBufferToImage(*staging.buffer, *destination.image, vk::ImageLayout::eTransferDstOptimal, copyRegion);
+
+    return UploadToken {m_lastSubmittedValue + 1u};
+}
+
+void StagingUploader::flush() {
+    if (!m_pendingBatch) {
+        return;
+    }
+    ZoneScoped;
+
+    Batch batch = std::move(*m_pendingBatch);
+    m_pendingBatch.reset();
+
+    batch.commandBuffer.end();
+    batch.signalValue = ++m_lastSubmittedValue;
+    batch.ringEnd     = m_ringHead;
+
+    // Every copy may have added waits, only the highest value of each semaphore matters
+    std::vector<vk::Semaphore>          waitSemaphores;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    std::vector<u64>                    waitValues;
+    for (const auto& wait : batch.waits) {
+        const auto it = std::ranges::find(waitSemaphores, wait.semaphore);
+        if (it == waitSemaphores.end()) {
+            waitSemaphores.push_back(wait.semaphore);
+            waitStages.push_back(vk::PipelineStageFlagBits::eTransfer);
+            waitValues.push_back(wait.value);
+            continue;
+        }
+        auto& value = waitValues [static_cast<size_t>(std::distance(waitSemaphores.begin(), it))];
+        value       = std::max(value, wait.value);
+    }
+    batch.waits.clear();
+
+    const vk::TimelineSemaphoreSubmitInfo timelineInfo(waitValues, batch.signalValue);
+    const vk::SubmitInfo                  submitInfo(waitSemaphores, waitStages, *batch.commandBuffer, *m_timelineSemaphore, &timelineInfo);
+    m_queue->submit(submitInfo);
+
+    m_inFlightBatches.emplace_back(std::move(batch));
+}
+
+void StagingUploader::setWaitResolver(WaitResolver resolver) {
+    m_waitResolver = std::move(resolver);
+}
+
+bool StagingUploader::isComplete(UploadToken token) const {
+    return token.value <= m_timelineSemaphore.getCounterValue();
+}
+
+void StagingUploader::wait(UploadToken token) {
+    ZoneScoped;
+    if (token.value > m_lastSubmittedValue) {
+        flush();
+    }
+
+    const vk::SemaphoreWaitInfo waitInfo({}, *m_timelineSemaphore, token.value);
+    while (vk::Result::eTimeout == m_device->waitSemaphores(waitInfo, FenceTimeout))
+        ;
+
+    retireCompletedBatches();
+}
+
+const vk::raii::Semaphore& StagingUploader::getTimelineSemaphore() const {
+    return m_timelineSemaphore;
+}
+
+StagingUploader::StagingAllocation StagingUploader::allocate(vk::DeviceSize size) {
+    // Uploads which would never fit into the ring get a staging buffer of their own which lives as long as the batch
+    if (size > m_capacity) {
+        auto& batch = getPendingBatch();
+        batch.dedicatedStaging.emplace_back(*m_allocator, size, vk::BufferUsageFlagBits::eTransferSrc);
+        const auto& staging = batch.dedicatedStaging.back();
+        return StagingAllocation {staging.buffer, 0u, staging.getMapped()};
+    }
+
+    retireCompletedBatches();
+
+    u64 begin = 0u;
+    while (true) {
+        begin = alignUp(m_ringHead, stagingAlignment);
+        if ((begin % m_capacity) + size > m_capacity) {
+            // Skip the remainder of the ring, the allocation has to be contiguous
+            begin = (begin / m_capacity + 1u) * m_capacity;
+        }
+        if (m_ringHead == m_ringTail) {
+            // Nothing is in use, so the skipped bytes can be released right away
+            m_ringTail = begin;
+        }
+        if (begin + size - m_ringTail <= m_capacity) {
+            break;
+        }
+
+        ZoneScopedN("Staging ring full");
+        if (m_inFlightBatches.empty()) {
+            // Everything still occupying the ring belongs to the batch being recorded
+            flush();
+        }
+        retireOldestBatch();
+    }
+
+    m_ringHead = begin + size;
+
+    const vk::DeviceSize offset = begin % m_capacity;
+    return StagingAllocation {m_ringBuffer.buffer, offset, m_ringMemory + offset};
+}
+
+StagingUploader::Batch& StagingUploader::getPendingBatch() {
+    if (!m_pendingBatch) {
+        vk::raii::CommandBuffer commandBuffer {nullptr};
+        if (m_freeCommandBuffers.empty()) {
+            commandBuffer = makeCommandBuffer(*m_device, m_commandPool);
+            registerDebugMarker(*m_device, commandBuffer, "Staging Upload");
+        }
+        else {
+            commandBuffer = std::move(m_freeCommandBuffers.back());
+            m_freeCommandBuffers.pop_back();
+            commandBuffer.reset();
+        }
+        commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        m_pendingBatch.emplace(Batch {std::move(commandBuffer)});
+    }
+    return *m_pendingBatch;
+}
+
+void StagingUploader::retireCompletedBatches() {
+    if (m_inFlightBatches.empty()) {
+        return;
+    }
+
+    const u64 completedValue = m_timelineSemaphore.getCounterValue();
+    while (!m_inFlightBatches.empty() && m_inFlightBatches.front().signalValue <= completedValue) {
+        m_ringTail = std::max(m_ringTail, m_inFlightBatches.front().ringEnd);
+        m_freeCommandBuffers.emplace_back(std::move(m_inFlightBatches.front().commandBuffer));
+        m_inFlightBatches.pop_front();
+    }
+}
+
+void StagingUploader::retireOldestBatch() {
+    assert(!m_inFlightBatches.empty());
+
+    const u64                   value = m_inFlightBatches.front().signalValue;
+    const vk::SemaphoreWaitInfo waitInfo({}, *m_timelineSemaphore, value);
+    while (vk::Result::eTimeout == m_device->waitSemaphores(waitInfo, FenceTimeout))
+        ;
+
+    retireCompletedBatches();
+}
+}   // namespace dnm
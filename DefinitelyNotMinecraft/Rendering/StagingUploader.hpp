@@ -0,0 +1,112 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <Core/ShortTypes.hpp>
+
+#include <Rendering/RAIIUtils.hpp>
+
+namespace dnm
+{
+// Value on the uploader's timeline semaphore which is reached once the upload landed on the device
+struct UploadToken
+{
+    u64 value = 0u;
+};
+
+// Records host to device copies from a persistently mapped staging ring into a command buffer for the
+// transfer queue. Pending copies are submitted as one batch on flush() and signal the timeline semaphore,
+// consumers wait on the returned token instead of stalling the host.
+class StagingUploader {
+    public:
+    StagingUploader(
+      DeviceMemoryAllocator& allocator,
+      const vk::raii::Queue& queue,
+      u32                    queueFamilyIndex,
+      vk::DeviceSize         capacity);
+    ~StagingUploader();
+
+    StagingUploader(const StagingUploader&)            = delete;
+    StagingUploader& operator=(const StagingUploader&) = delete;
+
+    UploadToken upload(const BufferData& destination, std::span<const std::byte> data, vk::DeviceSize destinationOffset = 0u);
+
+    template<typename T>
+    UploadToken upload(const BufferData& destination, std::span<const T> data, vk::DeviceSize destinationOffset = 0u) {
+        return upload(destination, std::as_bytes(data), destinationOffset);
+    }
+
+    // Copies into the first mip level, which is left in eTransferDstOptimal
+    UploadToken uploadImage(const ImageData& destination, vk::Extent2D extent, std::span<const std::byte> data);
+
+    void flush();
+
+    struct TimelineWait
+    {
+        vk::Semaphore semaphore;
+        u64           value = 0u;
+    };
+
+    // Asked for every buffer upload which work of earlier frames still reads or writes the destination, the batch
+    // containing the copy waits for it. Images are only uploaded before anything reads them.
+    using WaitResolver = std::function<void(vk::Buffer destination, std::vector<TimelineWait>& waits)>;
+    void setWaitResolver(WaitResolver resolver);
+
+    bool isComplete(UploadToken token) const;
+    void wait(UploadToken token);
+
+    const vk::raii::Semaphore& getTimelineSemaphore() const;
+
+    private:
+    struct Batch
+    {
+        vk::raii::CommandBuffer   commandBuffer;
+        u64                       signalValue = 0u;
+        u64                       ringEnd     = 0u;
+        std::vector<BufferData>   dedicatedStaging;
+        std::vector<TimelineWait> waits;
+    };
+
+    struct StagingAllocation
+    {
+        const vk::raii::Buffer& buffer;
+        vk::DeviceSize          offset;
+        std::byte*              memory;
+    };
+
+    StagingAllocation allocate(vk::DeviceSize size);
+    Batch&            getPendingBatch();
+    void              retireCompletedBatches();
+    void              retireOldestBatch();
+
+    DeviceMemoryAllocator*  m_allocator;
+    const vk::raii::Device* m_device;
+    const vk::raii::Queue*  m_queue;
+
+    vk::raii::CommandPool m_commandPool {nullptr};
+    vk::raii::Semaphore   m_timelineSemaphore {nullptr};
+
+    BufferData     m_ringBuffer {nullptr};
+    std::byte*     m_ringMemory {nullptr};
+    vk::DeviceSize m_capacity;
+
+    // Both are running byte counters, the position inside the ring is the counter modulo the capacity
+    u64 m_ringHead = 0u;
+    u64 m_ringTail = 0u;
+
+    std::optional<Batch>                 m_pendingBatch;
+    std::deque<Batch>                    m_inFlightBatches;
+    std::vector<vk::raii::CommandBuffer> m_freeCommandBuffers;
+
+    u64 m_lastSubmittedValue = 0u;
+
+    // Set by the render graph, which knows the last readers of its resources
+    WaitResolver m_waitResolver;
+};
+}   // namespace dnm
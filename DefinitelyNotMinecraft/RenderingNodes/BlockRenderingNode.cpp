@@ -1,5 +1,11 @@
 #include "RenderingNodes/BlockRenderingNode.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <functional>
+#include <numeric>
+
 #include <Core/GLMInclude.hpp>
 #include <Core/Profiler.hpp>
 #include <Core/StringInterner.hpp>
@@ -12,16 +18,19 @@ namespace dnm
 {
 namespace
 {
-    constexpr std::string_view computeShader = "Shaders/DrawCallGenerationWorld.comp";
+    constexpr std::string_view computeShader = drawCallGenerationShader.filePath;
+    constexpr std::string_view cullingShader = sectionCullingShader.filePath;
 
-    constexpr std::string_view localWGSizeX = "LOCAL_SIZE_X";
-    constexpr std::string_view localWGSizeY = "LOCAL_SIZE_Y";
-    constexpr std::string_view localWGSizeZ = "LOCAL_SIZE_Z";
+    static_assert(BlockWorld::chunkLocalSize == 32u, "The work group size in drawCallGenerationDefines has to follow the chunk size");
 
-    constexpr std::string_view worldDataBindingPoint      = "worldDataBuffer";
-    constexpr std::string_view chunkConstantsBindingPoint = "chunkConstants";
-    constexpr std::string_view chunkRemapBindingPoint     = "chunkIndexRemap";
-    constexpr std::string_view cullingBindingPoint        = "cullingData";
+    constexpr std::string_view worldDataBindingPoint         = "worldDataBuffer";
+    constexpr std::string_view chunkConstantsBindingPoint    = "chunkConstants";
+    constexpr std::string_view chunkRemapBindingPoint        = "chunkIndexRemap";
+    constexpr std::string_view residentFaceBindingPoint      = "residentFaceBuffer";
+    constexpr std::string_view sectionRangeBindingPoint      = "sectionRangeBuffer";
+    constexpr std::string_view faceCursorBindingPoint        = "faceCursorBuffer";
+    constexpr std::string_view cullingBindingPoint           = "cullingData";
+    constexpr std::string_view sectionVisibilityBindingPoint = "sectionVisibilityBuffer";
 
     struct alignas(16) Plane
     {
@@ -29,31 +38,136 @@ namespace
         float distance;
     };
 
+    // Layout of the cullingData uniform in Shaders/BlockWorldBuffer.glsl
     struct alignas(16) CullingData
     {
+        m4    viewProjection;
         Plane frustum [6];
+        v3    cameraPosition;
         u32   cullingEnabled;
+        u32   faceCullingEnabled;
+        u32   occlusionCullingEnabled;
+    };
+
+    // Layout of OcclusionCandidate in Shaders/OcclusionBuffer.glsl
+    struct OcclusionCandidate
+    {
+        v3  boxMin;
+        u32 firstDraw;
+        v3  boxMax;
+        u32 drawCount;
+    };
+
+    // Layout of the drawCountBuffer in Shaders/BlockWorldBuffer.glsl, the draw count comes first for vkCmdDrawIndirectCount
+    struct DrawCounters
+    {
+        u32 drawCount;
+        u32 visibleFaces;
+        u32 occupiedSections;
+        u32 backFacingFaces;
+    };
+
+    constexpr u32 sectionCullingGroupSize = 64u;
+    static_assert(maxSectionDrawCount == maxChunkSlots * BlockWorld::sectionsPerChunk * BlockWorld::faceDirectionCount);
+
+    constexpr u32 verticesPerFace = 6u;
+
+    // Faces are packed into a u32, see Shaders/PackedFace.glsl
+    using PackedFace = u32;
+
+    // Sizes of the resident face pool in faces, ranges are handed out by a buddy allocator
+    constexpr u64 initialFacePoolCapacity = 1u << 21u;
+    constexpr u64 minFaceRangeSize        = 1u << 10u;
+
+    struct FaceRange
+    {
+        u32 offset;
+        u32 count;
     };
+
+    using RangeFaceCounts = std::array<u32, BlockWorld::sectionsPerChunk * BlockWorld::faceDirectionCount>;
+    using ExposedLayers   = std::bitset<BlockWorld::chunkHeight>;
+
+    // Has to match the faces isFaceExposed in Shaders/BlockWorldUtil.glsl reports
+    RangeFaceCounts countExposedFaces(std::span<const BlockType> blocks, ExposedLayers& exposedLayers) {
+        ZoneScoped;
+        constexpr u32 directionBitsOffset = static_cast<u32>(sizeof(BlockType) * 8u - BlockWorld::faceDirectionCount);
+        constexpr u64 layerBlockCount     = BlockWorld::chunkLocalSize * BlockWorld::chunkLocalSize;
+
+        RangeFaceCounts counts {};
+        exposedLayers.reset();
+        for (u64 i = 0u; i < blocks.size(); ++i) {
+            const BlockType block = blocks [i];
+            if (block == BlockWorld::air) {
+                continue;
+            }
+            if ((static_cast<u32>(block) >> directionBitsOffset) != 0u) {
+                exposedLayers.set(i / layerBlockCount);
+            }
+
+            const u64 firstRange = (i / BlockWorld::perSectionBlockCount) * BlockWorld::faceDirectionCount;
+            for (u32 direction = 0u; direction < BlockWorld::faceDirectionCount; ++direction) {
+                counts [firstRange + direction] += (static_cast<u32>(block) >> (directionBitsOffset + direction)) & 1u;
+            }
+        }
+        return counts;
+    }
 }   // namespace
 
 BlockDrawCallNode::BlockDrawCallNode(Config* config, Renderer* renderer, ShaderManager* shaderManager, BlockWorld* blockWorld, StringInterner* interner) :
     m_config {config}, m_renderer {renderer}, m_shaderManager {shaderManager}, m_blockWorld {blockWorld}, m_interner {interner} {
-    const auto& physicalDevice = m_renderer->getPhysicalDevice();
-    const auto& device         = m_renderer->getDevice();
-
-    m_computeHandle = m_shaderManager->registerShaderFile(m_interner->addOrGetString(computeShader), vk::ShaderStageFlagBits::eCompute);
+    m_computeHandle = m_shaderManager->registerShaderFile(drawCallGenerationShader);
+    m_cullingHandle = m_shaderManager->registerShaderFile(sectionCullingShader);
+
+    // Sized for the largest window, so the forward pass can pass the same maximum draw count for any window
+    for (auto& frameBuffers : m_frameBuffers) {
+        frameBuffers.drawCommands = m_renderer->createBuffer(
+          maxSectionDrawCount * sizeof(vk::DrawIndexedIndirectCommand),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+          "Section Draw Commands",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        frameBuffers.drawCount = m_renderer->createBuffer(
+          sizeof(DrawCounters),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst |
+            vk::BufferUsageFlagBits::eTransferSrc,
+          "Section Draw Count",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        frameBuffers.occlusionCandidates = m_renderer->createBuffer(
+          maxOcclusionCandidateCount * sizeof(OcclusionCandidate),
+          vk::BufferUsageFlagBits::eStorageBuffer,
+          "Occlusion Candidates",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        frameBuffers.candidateDraws = m_renderer->createBuffer(
+          maxSectionDrawCount * sizeof(vk::DrawIndexedIndirectCommand),
+          vk::BufferUsageFlagBits::eStorageBuffer,
+          "Candidate Draw Commands",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        // The late culling is dispatched from and draws with the counters in here
+        frameBuffers.occlusionCount = m_renderer->createBuffer(
+          sizeof(OcclusionCounters),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst |
+            vk::BufferUsageFlagBits::eTransferSrc,
+          "Occlusion Counters",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }
+    m_drawCommandRegistration        = registerFrameBuffers(GlobalBuffers::DrawCommand, &FrameBuffers::drawCommands);
+    m_drawCountRegistration          = registerFrameBuffers(GlobalBuffers::DrawCount, &FrameBuffers::drawCount);
+    m_occlusionCandidateRegistration = registerFrameBuffers(GlobalBuffers::OcclusionCandidate, &FrameBuffers::occlusionCandidates);
+    m_candidateDrawRegistration      = registerFrameBuffers(GlobalBuffers::OcclusionCandidateDraw, &FrameBuffers::candidateDraws);
+    m_occlusionCountRegistration     = registerFrameBuffers(GlobalBuffers::OcclusionCount, &FrameBuffers::occlusionCount);
 
-    m_drawCommandBuffer =
-      BufferData(physicalDevice, device, 6 * sizeof(u32), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
-    registerDebugMarker(device, m_drawCommandBuffer.buffer, "Drawcommand Buffer");
-    m_drawCommandRegistration = renderer->registerRAIIBuffer(GlobalBuffers::DrawCommand, m_drawCommandBuffer);
+    m_counterReadback =
+      m_renderer->createBuffer(sizeof(DrawCounters) * Renderer::maxFramesInFlight, vk::BufferUsageFlagBits::eTransferDst, "Draw Count Readback");
+    memset(m_counterReadback.getMapped(), 0, m_counterReadback.getSize());
 
     recreateBlockDependentBuffers();
 
     m_computeProfilerContext = GPUProfilerContext(m_renderer);
 
-    m_cullingData = m_renderer->createBuffer(sizeof(CullingData), vk::BufferUsageFlagBits::eUniformBuffer, "Culling Data");
-
     recompileShadersIfNecessary(true);
 }
 
@@ -61,59 +175,84 @@ std::string_view BlockDrawCallNode::getName() const {
     return "BlockDrawCallNode";
 }
 
+std::unique_ptr<BufferRegistration> BlockDrawCallNode::registerFrameBuffers(GlobalBuffers identifier, dnm::BufferData FrameBuffers::*member) {
+    Renderer::PerFrameBuffers buffers {};
+    for (u32 i = 0u; i < Renderer::maxFramesInFlight; ++i) {
+        buffers [i] = &(m_frameBuffers [i].*member);
+    }
+    return m_renderer->registerRAIIBuffer(identifier, buffers);
+}
+
 void BlockDrawCallNode::recreatePipeline() {
     m_renderer->waitIdle();
 
     const auto& device = m_renderer->getDevice();
 
-    m_descriptorSet.clear();
+    for (auto& frameBuffers : m_frameBuffers) {
+        frameBuffers.descriptorSet.clear();
+    }
 
+    // All passes include the same buffers, so they share one layout and each frame in flight one descriptor set
     std::vector<BindingSlot> slots;
     vk::ShaderStageFlags     stageFlags;
-    auto                     internedString = m_interner->addOrGetString(computeShader);
-    m_shaderManager->getBindingSlots(std::span {&internedString, 1u}, slots, stageFlags);
+    std::array               internedString {m_interner->addOrGetString(computeShader), m_interner->addOrGetString(cullingShader)};
+    m_shaderManager->getBindingSlots(internedString, slots, stageFlags);
+    std::array dynamicSlots {cullingBindingPoint, sectionVisibilityBindingPoint};
+    makeSlotsDynamic(slots, dynamicSlots);
     m_descriptorSetLayout = makeDescriptorSetLayout(device, slots, stageFlags);
     m_pipelineLayout      = vk::raii::PipelineLayout(device, {{}, *m_descriptorSetLayout});
 
-    auto sets       = vk::raii::DescriptorSets(device, {*m_renderer->getDescriptorPool(), *m_descriptorSetLayout});
-    m_descriptorSet = std::move(sets.front());
+    const std::vector<vk::DescriptorSetLayout> layouts(Renderer::maxFramesInFlight, *m_descriptorSetLayout);
+    auto                                       sets = vk::raii::DescriptorSets(device, {*m_renderer->getDescriptorPool(), layouts});
 
     m_computePipeline = makeComputePipeline(device, m_renderer->getPipelineCache(), m_drawCallGenerationComputeModule, nullptr, m_pipelineLayout);
     registerDebugMarker(device, m_computePipeline, "Draw Call Generation Compute Pipeline");
 
-    const auto* projectionClipBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::ProjectionClip);
-    assert(projectionClipBuffer);
-    const auto* viewBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::CameraView);
-    assert(viewBuffer);
-
-    std::array update {
-      DescriptorSlotUpdate {projectionBufferBindingPoint,         *projectionClipBuffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {      viewBufferBindingPoint,                   *viewBuffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {       transformBindingPoint,      m_transformBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {       blockTypeBindingPoint,      m_blockTypeBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {       worldDataBindingPoint,      m_worldDataBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {     drawCommandBindingPoint,    m_drawCommandBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {  chunkConstantsBindingPoint, m_chunkConstantsBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {      chunkRemapBindingPoint,      m_chunkRemapIndex.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {         cullingBindingPoint,          m_cullingData.buffer, VK_WHOLE_SIZE, nullptr}
-    };
+    m_cullingPipeline = makeComputePipeline(device, m_renderer->getPipelineCache(), m_sectionCullingComputeModule, nullptr, m_pipelineLayout);
+    registerDebugMarker(device, m_cullingPipeline, "Section Culling Compute Pipeline");
+    m_renderer->markPipelineCacheDirty();
+
+    const auto& frameBuffer = m_renderer->getFrameAllocator().getBuffer().buffer;
+    for (u32 frameIndex = 0u; frameIndex < Renderer::maxFramesInFlight; ++frameIndex) {
+        auto&       frameBuffers = m_frameBuffers [frameIndex];
+        const auto* depthPyramid = m_renderer->getGlobalBuffer(GlobalBuffers::DepthPyramid, frameIndex);
+        assert(depthPyramid);
+        frameBuffers.descriptorSet = std::move(sets [frameIndex]);
+
+        std::array update {
+          DescriptorSlotUpdate {      chunkOriginBindingPoint,         frameBuffers.chunkOrigin.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {     residentFaceBindingPoint,       frameBuffers.residentFaces.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {     sectionRangeBindingPoint,             m_sectionRangeBuffer.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {       faceCursorBindingPoint,               m_faceCursorBuffer.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {        worldDataBindingPoint,                m_worldDataBuffer.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {      drawCommandBindingPoint,        frameBuffers.drawCommands.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {        drawCountBindingPoint,           frameBuffers.drawCount.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {   chunkConstantsBindingPoint,           m_chunkConstantsBuffer.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {       chunkRemapBindingPoint,                m_chunkRemapIndex.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {          cullingBindingPoint,                             frameBuffer,         sizeof(CullingData), nullptr},
+          DescriptorSlotUpdate {sectionVisibilityBindingPoint,                             frameBuffer, sizeof(u32) * maxChunkSlots, nullptr},
+          DescriptorSlotUpdate {     depthPyramidBindingPoint,                           *depthPyramid,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {        candidateBindingPoint, frameBuffers.occlusionCandidates.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {    candidateDrawBindingPoint,      frameBuffers.candidateDraws.buffer,               VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {   occlusionCountBindingPoint,      frameBuffers.occlusionCount.buffer,               VK_WHOLE_SIZE, nullptr}
+        };
+        updateDescriptorSets(device, frameBuffers.descriptorSet, update, slots);
+    }
 
-    updateDescriptorSets(device, m_descriptorSet, update, slots);
+    m_slots               = std::move(slots);
+    m_globalBufferVersion = m_renderer->getGlobalBufferVersion();
 }
 
 void BlockDrawCallNode::recompileShadersIfNecessary(bool force) {
     const auto& device = m_renderer->getDevice();
 
-    std::array defines = {
-      ShaderManager::Define {m_interner->addOrGetString(localWGSizeX), std::to_string(m_blockWorld->chunkLocalSize)},
-      ShaderManager::Define {m_interner->addOrGetString(localWGSizeY),                            std::to_string(1)},
-      ShaderManager::Define {m_interner->addOrGetString(localWGSizeZ), std::to_string(m_blockWorld->chunkLocalSize)}
-    };
-
-    if (m_shaderManager->wasContentUpdated(m_computeHandle) || force) {
-        auto recompiledVertexShader = m_shaderManager->getCompiledVersion(device, m_computeHandle, defines);
-        if (recompiledVertexShader) {
-            m_drawCallGenerationComputeModule = std::move(recompiledVertexShader.value());
+    const bool anyUpdated = m_shaderManager->wasContentUpdated(m_computeHandle) || m_shaderManager->wasContentUpdated(m_cullingHandle);
+    if (anyUpdated || force) {
+        auto recompiledGenerationShader = m_shaderManager->getCompiledVersion(device, m_computeHandle);
+        auto recompiledCullingShader    = m_shaderManager->getCompiledVersion(device, m_cullingHandle);
+        if (recompiledGenerationShader && recompiledCullingShader) {
+            m_drawCallGenerationComputeModule = std::move(recompiledGenerationShader.value());
+            m_sectionCullingComputeModule     = std::move(recompiledCullingShader.value());
 
             recreatePipeline();
             std::cout << "Successfully recompiled shaders and recreated the pipeline "
@@ -123,49 +262,199 @@ void BlockDrawCallNode::recompileShadersIfNecessary(bool force) {
 }
 
 void BlockDrawCallNode::recreateBlockDependentBuffers() {
+    // The frames in flight still read the buffers which are replaced
+    m_renderer->waitIdle();
+
     const u32 oneDimensionChunkCount    = 1 + m_config->loadCountChunks * 2u;
     const u32 blockCountAllLoadedChunks = BlockWorld::perChunkBlockCount * oneDimensionChunkCount * oneDimensionChunkCount;
 
-    m_transformBuffer = m_renderer->createBuffer(
-      blockCountAllLoadedChunks * sizeof(v4), vk::BufferUsageFlagBits::eStorageBuffer, "Instance Transform Buffer", vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-    m_transformRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::Transform, m_transformBuffer);
+    m_chunkConstantsBuffer = m_renderer->createBuffer(
+      sizeof(u32) * 5,
+      vk::BufferUsageFlagBits::eUniformBuffer,
+      "Chunk Constants",
+      vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
+    writeChunkConstants();
 
     m_worldDataBuffer = m_renderer->createBuffer(
       blockCountAllLoadedChunks * sizeof(BlockType),
-      vk::BufferUsageFlagBits::eStorageBuffer,
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
       "World Data Blocks",
-      vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    m_blockTypeBuffer = m_renderer->createBuffer(
-      static_cast<u64>(blockCountAllLoadedChunks) * (sizeof(u32) * 2u) * 6u,
-      vk::BufferUsageFlagBits::eStorageBuffer,
-      "Block Data For Draw Command",
+    const u32 windowChunkCount = oneDimensionChunkCount * oneDimensionChunkCount;
+
+    // The remap index and the slot tables are copied in from the frame allocator whenever they change
+    m_chunkRemapIndex = m_renderer->createBuffer(
+      windowChunkCount * BlockWorld::chunkHeight * sizeof(u32),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Chunk Remap Index",
       vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    m_blockTypeRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::BlockType, m_blockTypeBuffer);
+    // The forward pass reads them next to the faces, so a frame updating them must not overwrite those of earlier frames
+    m_chunkOriginRegistration.reset();
+    for (auto& frameBuffers : m_frameBuffers) {
+        frameBuffers.chunkOrigin = m_renderer->createBuffer(
+          windowChunkCount * sizeof(glm::ivec2),
+          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+          "Chunk Origins",
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }
+    m_chunkOriginRegistration = registerFrameBuffers(GlobalBuffers::ChunkOrigin, &FrameBuffers::chunkOrigin);
 
-    std::array<u32, 4u> constants {m_config->loadCountChunks, oneDimensionChunkCount, BlockWorld::chunkLocalSize, BlockWorld::chunkHeight};
+    const u32 windowRangeCount = windowChunkCount * static_cast<u32>(BlockWorld::sectionsPerChunk * BlockWorld::faceDirectionCount);
 
-    m_chunkConstantsBuffer = m_renderer->createBuffer(
-      sizeof(u32) * 4,
-      vk::BufferUsageFlagBits::eUniformBuffer,
-      "Chunk Constants",
-      vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
+    // Slots without a chunk keep empty ranges, so the culling skips them
+    m_sectionRangeBuffer = m_renderer->createBuffer(
+      windowRangeCount * sizeof(FaceRange),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Section Face Ranges",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    copyToDevice(m_chunkConstantsBuffer.deviceMemory, std::span<const u32>(constants));
+    m_faceCursorBuffer = m_renderer->createBuffer(
+      windowRangeCount * sizeof(u32),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Face Cursors",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    m_chunkRemapIndex =
-      m_renderer->createBuffer(oneDimensionChunkCount * oneDimensionChunkCount * sizeof(u32), vk::BufferUsageFlagBits::eStorageBuffer, "Chunk Remap Index");
+    // The new buffers are empty, so every chunk of the window has to be uploaded again
+    m_residentChunks.assign(windowChunkCount, ResidentChunk {});
+    m_chunkSlots.clear();
+    m_freeSlots.resize(windowChunkCount);
+    for (u32 i = 0u; i < windowChunkCount; ++i) {
+        m_freeSlots [i] = windowChunkCount - 1u - i;
+    }
+    rebuildFacePool(initialFacePoolCapacity);
+
+    m_allChunksUploadedLastFrame = false;
+    m_staleSlotTables.set();
 
     loadCountChunksLastFrame = m_config->loadCountChunks;
 }
 
-bool BlockDrawCallNode::updateBlockWorldData(v3 cameraPosition) {
-    ZoneScoped;
+void BlockDrawCallNode::writeChunkConstants() const {
     const u32 oneDimensionChunkCount = 1 + m_config->loadCountChunks * 2u;
-    u32       workGroupCount         = oneDimensionChunkCount * oneDimensionChunkCount;
 
+    std::array<u32, 5u> constants {
+      m_config->loadCountChunks, oneDimensionChunkCount, BlockWorld::chunkLocalSize, BlockWorld::chunkHeight, BlockWorld::sectionHeight};
+    m_chunkConstantsBuffer.write(std::span<const u32>(constants));
+}
+
+void BlockDrawCallNode::plotDrawCounters() const {
+    // The fence of the frame which last wrote this copy was already waited on
+    DrawCounters counters;
+    memcpy(&counters, m_counterReadback.getMapped() + m_renderer->getFrameIndex() * sizeof(DrawCounters), sizeof(counters));
+
+    TracyPlot("Visible Faces", static_cast<i64>(counters.visibleFaces));
+    TracyPlot("Visible Sections", static_cast<i64>(counters.drawCount));
+    TracyPlot("Occupied Sections", static_cast<i64>(counters.occupiedSections));
+    TracyPlot("Visible Sections %", counters.occupiedSections > 0u ? 100.0 * counters.drawCount / counters.occupiedSections : 0.0);
+
+    // Faces inside the frustum which were skipped for facing away, each one saves its vertex shader invocations
+    const u32 frustumFaces = counters.visibleFaces + counters.backFacingFaces;
+    TracyPlot("Back Facing Faces", static_cast<i64>(counters.backFacingFaces));
+    TracyPlot("Back Facing Faces %", frustumFaces > 0u ? 100.0 * counters.backFacingFaces / frustumFaces : 0.0);
+    TracyPlot("Saved Vertex Invocations", static_cast<i64>(counters.backFacingFaces) * verticesPerFace);
+}
+
+u32 BlockDrawCallNode::acquireSlot(glm::ivec2 chunk) {
+    assert(!m_freeSlots.empty());
+    const u32 slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    m_chunkSlots.emplace(chunk, slot);
+    m_residentChunks [slot] = ResidentChunk {.position = chunk, .inUse = true};
+    return slot;
+}
+
+void BlockDrawCallNode::releaseSlot(u32 slot) {
+    auto& resident = m_residentChunks [slot];
+    if (resident.faceCount > 0u) {
+        m_facePool->free(resident.faceOffset, resident.faceCount);
+    }
+    resident = ResidentChunk {};
+    m_staleSlotTables.set();
+    m_freeSlots.emplace_back(slot);
+}
+
+bool BlockDrawCallNode::allocateFaceRange(ResidentChunk& resident) {
+    if (resident.faceCount == 0u) {
+        return true;
+    }
+
+    const auto offset = m_facePool->allocate(resident.faceCount);
+    if (!offset) {
+        return false;
+    }
+    resident.faceOffset = static_cast<u32>(*offset);
+    return true;
+}
+
+void BlockDrawCallNode::rebuildFacePool(u64 capacity) {
+    ZoneScoped;
+    m_renderer->waitIdle();
+
+    // Placing the largest ranges first keeps the pool from fragmenting
+    std::vector<u32> slots;
+    for (u32 slot = 0u; slot < m_residentChunks.size(); ++slot) {
+        if (m_residentChunks [slot].inUse) {
+            slots.emplace_back(slot);
+        }
+    }
+    std::ranges::sort(slots, std::greater {}, [this](u32 slot) { return m_residentChunks [slot].faceCount; });
+
+    while (true) {
+        m_facePool.emplace(capacity, minFaceRangeSize);
+        const bool fits = std::ranges::all_of(slots, [this](u32 slot) { return allocateFaceRange(m_residentChunks [slot]); });
+        if (fits) {
+            break;
+        }
+        capacity *= 2u;
+    }
+
+    // The old registration has to go first, destroying it afterwards would unregister the new buffers
+    m_faceRegistration.reset();
+    for (auto& frameBuffers : m_frameBuffers) {
+        frameBuffers.residentFaces = m_renderer->createBuffer(
+          capacity * sizeof(PackedFace), vk::BufferUsageFlagBits::eStorageBuffer, "Resident Faces", vk::MemoryPropertyFlagBits::eDeviceLocal);
+    }
+    m_faceRegistration = registerFrameBuffers(GlobalBuffers::Face, &FrameBuffers::residentFaces);
+
+    // The world data is still resident, only the faces of every frame in flight have to be generated again
+    for (const u32 slot : slots) {
+        m_residentChunks [slot].pendingGeneration.set();
+    }
+    m_staleSlotTables.set();
+}
+
+void BlockDrawCallNode::recordSlotTableCopies(const vk::raii::CommandBuffer& commandBuffer, FrameBuffers& frameBuffers) {
+    ZoneScoped;
+    // Frames in flight may still read the tables, so they are copied in on the GPU timeline instead of being written in place
+    std::vector<glm::ivec2> origins(m_residentChunks.size());
+    std::vector<FaceRange>  ranges(m_residentChunks.size() * std::tuple_size_v<RangeFaceCounts>);
+    for (u32 slot = 0u; slot < m_residentChunks.size(); ++slot) {
+        const auto& resident = m_residentChunks [slot];
+        origins [slot]       = resident.position * static_cast<i32>(BlockWorld::chunkLocalSize);
+
+        // The sections of a chunk and their face directions are laid out one after another in its range
+        const u32 firstRange  = slot * static_cast<u32>(std::tuple_size_v<RangeFaceCounts>);
+        u32       rangeOffset = resident.faceOffset;
+        for (u32 range = 0u; range < std::tuple_size_v<RangeFaceCounts>; ++range) {
+            ranges [firstRange + range] = FaceRange {rangeOffset, resident.rangeFaceCounts [range]};
+            rangeOffset += resident.rangeFaceCounts [range];
+        }
+    }
+
+    auto&       frameAllocator = m_renderer->getFrameAllocator();
+    const auto& source         = *frameAllocator.getBuffer().buffer;
+    const u32   originOffset   = frameAllocator.push(std::span<const glm::ivec2>(origins));
+    const u32   rangesOffset   = frameAllocator.push(std::span<const FaceRange>(ranges));
+    commandBuffer.copyBuffer(source, *frameBuffers.chunkOrigin.buffer, vk::BufferCopy(originOffset, 0u, origins.size() * sizeof(glm::ivec2)));
+    commandBuffer.copyBuffer(source, *m_sectionRangeBuffer.buffer, vk::BufferCopy(rangesOffset, 0u, ranges.size() * sizeof(FaceRange)));
+    m_staleSlotTables.reset(m_renderer->getFrameIndex());
+}
+
+bool BlockDrawCallNode::updateBlockWorldData(v3 cameraPosition) {
+    ZoneScoped;
     const glm::ivec2 cameraChunk {cameraPosition.x / BlockWorld::chunkLocalSize, cameraPosition.z / BlockWorld::chunkLocalSize};
 
     const glm::ivec2 min {cameraChunk.x - m_config->loadCountChunks, cameraChunk.y - m_config->loadCountChunks};
@@ -181,42 +470,103 @@ bool BlockDrawCallNode::updateBlockWorldData(v3 cameraPosition) {
         }
     }
 
-    const bool requiresChunkDataUpdate =
-      cameraChunk != m_cameraChunkLastFrame || !m_allChunksUploadedLastFrame || chunkDirty || m_config->everyFrameGenerateDrawCalls;
+    const bool requiresChunkDataUpdate = cameraChunk != m_cameraChunkLastFrame || !m_allChunksUploadedLastFrame || chunkDirty;
 
+    bool poolRecreated = false;
     if (requiresChunkDataUpdate) {
         m_allChunksUploadedLastFrame = true;
         m_cameraChunkLastFrame       = cameraChunk;
 
-        std::vector<u32> remapIndex;
-        remapIndex.reserve(workGroupCount);
-        std::vector blockData(BlockWorld::perChunkBlockCount * workGroupCount, BlockWorld::air);
+        // Chunks which left the window give their slot and face range back
+        for (auto it = m_chunkSlots.begin(); it != m_chunkSlots.end();) {
+            const glm::ivec2 chunk = it->first;
+            if (chunk.x < min.x || chunk.x > max.x || chunk.y < min.y || chunk.y > max.y) {
+                releaseSlot(it->second);
+                it = m_chunkSlots.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
 
-        u32 counter = 0u;
+        auto& uploader = m_renderer->getUploader();
+
+        bool poolExhausted = false;
         for (i32 z = min.y; z <= max.y; ++z) {
             for (i32 x = min.x; x <= max.x; ++x) {
                 const glm::ivec2 chunk {x, z};
-                const auto       state = m_blockWorld->requestChunk(chunk);
+                // Has to be queried before the request processes the pending visibility update
+                const bool dirty = m_blockWorld->isRenderingDirty(chunk);
+                const auto state = m_blockWorld->requestChunk(chunk);
                 if (state != BlockWorld::ChunkState::FinishedGeneration) {
                     m_allChunksUploadedLastFrame = false;
-                    ++counter;
                     continue;
                 }
-                remapIndex.emplace_back(counter);
-                auto data = m_blockWorld->getChunkData(chunk);
-                std::copy(data.begin(), data.end(), blockData.begin() + counter * BlockWorld::perChunkBlockCount);
-                ++counter;
+
+                const auto slotIt = m_chunkSlots.find(chunk);
+                if (slotIt != m_chunkSlots.end() && !dirty) {
+                    continue;
+                }
+
+                const u32 slot = slotIt != m_chunkSlots.end() ? slotIt->second : acquireSlot(chunk);
+                auto      data = m_blockWorld->getChunkData(chunk);
+                m_worldDataUpload =
+                  uploader.upload(m_worldDataBuffer, std::span<const BlockType>(data), slot * BlockWorld::perChunkBlockCount * sizeof(BlockType));
+
+                auto& resident = m_residentChunks [slot];
+                if (resident.faceCount > 0u) {
+                    m_facePool->free(resident.faceOffset, resident.faceCount);
+                }
+                resident.rangeFaceCounts = countExposedFaces(data, resident.exposedLayers);
+                resident.faceCount       = std::accumulate(resident.rangeFaceCounts.begin(), resident.rangeFaceCounts.end(), 0u);
+                resident.pendingGeneration.set();
+                if (!allocateFaceRange(resident)) {
+                    // The chunk has no valid range, the rebuild below places it
+                    resident.faceOffset = 0u;
+                    poolExhausted       = true;
+                    continue;
+                }
+                m_staleSlotTables.set();
             }
         }
 
-        copyToDevice(m_worldDataBuffer.deviceMemory, std::span<const BlockType>(blockData));
-        workGroupCount = remapIndex.size();
-        if (workGroupCount > 0) {
-            copyToDevice(m_chunkRemapIndex.deviceMemory, std::span<const u32>(remapIndex));
+        const u64 poolCapacity = m_facePool->getCapacity();
+        if (poolExhausted) {
+            rebuildFacePool(poolCapacity * 2u);
+            poolRecreated = true;
+        }
+        else if (poolCapacity > initialFacePoolCapacity && m_facePool->getUsedSize() < poolCapacity / 4u) {
+            rebuildFacePool(poolCapacity / 2u);
+            poolRecreated = true;
+        }
+    }
+
+    // Only this frame's copy of the resident faces is brought up to date, the other frames catch up when they come around
+    const u32 frameIndex = m_renderer->getFrameIndex();
+    m_generationSlots.clear();
+    m_generationLayers.clear();
+    for (u32 slot = 0u; slot < m_residentChunks.size(); ++slot) {
+        auto& resident = m_residentChunks [slot];
+        if (resident.inUse && resident.faceCount > 0u && (resident.pendingGeneration.test(frameIndex) || m_config->everyFrameGenerateDrawCalls)) {
+            m_generationSlots.emplace_back(slot);
+            // Workgroups of layers without exposed faces would return right away, so they are not dispatched at all
+            for (u32 layer = 0u; layer < BlockWorld::chunkHeight; ++layer) {
+                if (resident.exposedLayers.test(layer)) {
+                    m_generationLayers.emplace_back(slot * static_cast<u32>(BlockWorld::chunkHeight) + layer);
+                }
+            }
         }
+        resident.pendingGeneration.reset(frameIndex);
     }
 
-    return requiresChunkDataUpdate;
+    const u64 generationLayerCount = m_generationSlots.size() * BlockWorld::chunkHeight;
+    TracyPlot("Regenerated Chunks", static_cast<i64>(m_generationSlots.size()));
+    TracyPlot("Regenerated Layers", static_cast<i64>(m_generationLayers.size()));
+    TracyPlot("Skipped Layers %", generationLayerCount > 0u ? 100.0 * (generationLayerCount - m_generationLayers.size()) / generationLayerCount : 0.0);
+    TracyPlot("Resident Faces", static_cast<i64>(m_facePool->getUsedSize()));
+    TracyPlot("Face Pool Capacity", static_cast<i64>(m_facePool->getCapacity()));
+
+    return poolRecreated;
 }
 
 namespace
@@ -229,7 +579,7 @@ namespace
     }
 }   // namespace
 
-void BlockDrawCallNode::updateCullingData(const Camera* camera) const {
+u32 BlockDrawCallNode::updateCullingData(const Camera* camera) const {
     ZoneScoped;
 
     const float zNear = m_config->nearPlane;
@@ -246,54 +596,166 @@ void BlockDrawCallNode::updateCullingData(const Camera* camera) const {
     const float halfHSide    = halfVSide * aspect;
     const v3    frontMultFar = zFar * forward;
 
+    const v3 cameraPosition = camera->getPosition();
+
     CullingData data;
-    data.cullingEnabled = m_config->cullingEnabled;
+    data.viewProjection          = m_renderer->getProjectionMatrix() * camera->getViewMatrix();
+    data.cameraPosition          = cameraPosition;
+    data.cullingEnabled          = m_config->cullingEnabled;
+    data.faceCullingEnabled      = m_config->faceCullingEnabled;
+    data.occlusionCullingEnabled = m_config->occlusionCullingEnabled;
+    data.frustum [0]             = convertToPlane(cameraPosition + zNear * forward, forward);
+    data.frustum [1]             = convertToPlane(cameraPosition + frontMultFar, -forward);
+    data.frustum [2]             = convertToPlane(cameraPosition, glm::cross(frontMultFar - right * halfHSide, up));
+    data.frustum [3]             = convertToPlane(cameraPosition, glm::cross(up, frontMultFar + right * halfHSide));
+    data.frustum [4]             = convertToPlane(cameraPosition, glm::cross(right, frontMultFar - up * halfVSide));
+    data.frustum [5]             = convertToPlane(cameraPosition, glm::cross(frontMultFar + up * halfVSide, right));
+
+    return m_renderer->getFrameAllocator().push(data);
+}
 
-    const v3 cameraPosition = camera->getPosition();
-    data.frustum [0]        = convertToPlane(cameraPosition + zNear * forward, forward);
-    data.frustum [1]        = convertToPlane(cameraPosition + frontMultFar, -forward);
-    data.frustum [2]        = convertToPlane(cameraPosition, glm::cross(frontMultFar - right * halfHSide, up));
-    data.frustum [3]        = convertToPlane(cameraPosition, glm::cross(up, frontMultFar + right * halfHSide));
-    data.frustum [4]        = convertToPlane(cameraPosition, glm::cross(right, frontMultFar - up * halfVSide));
-    data.frustum [5]        = convertToPlane(cameraPosition, glm::cross(frontMultFar + up * halfVSide, right));
-
-    copyToDevice(m_cullingData.deviceMemory, std::span<const CullingData>(&data, 1u));
+u32 BlockDrawCallNode::updateSectionVisibility(const Camera* camera) {
+    ZoneScoped;
+    constexpr u32 allSectionsVisible = (1u << BlockWorld::sectionsPerChunk) - 1u;
+
+    std::array<u32, maxChunkSlots> sectionMasks;
+    sectionMasks.fill(allSectionsVisible);
+    if (m_config->caveCullingEnabled) {
+        m_blockWorld->collectVisibleSections(camera->getPosition(), m_config->loadCountChunks, m_visibleSections);
+
+        u32 residentSections = 0u;
+        u32 visibleSections  = 0u;
+        for (u32 slot = 0u; slot < m_residentChunks.size(); ++slot) {
+            const auto& resident = m_residentChunks [slot];
+            if (!resident.inUse) {
+                continue;
+            }
+
+            const auto it        = m_visibleSections.find(resident.position);
+            sectionMasks [slot]  = it != m_visibleSections.end() ? it->second : 0u;
+            residentSections    += static_cast<u32>(BlockWorld::sectionsPerChunk);
+            visibleSections     += static_cast<u32>(std::popcount(sectionMasks [slot]));
+        }
+
+        TracyPlot("Potentially Visible Sections", static_cast<i64>(visibleSections));
+        TracyPlot("Cave Culled Sections %", residentSections > 0u ? 100.0 * (residentSections - visibleSections) / residentSections : 0.0);
+    }
+
+    return m_renderer->getFrameAllocator().push(std::span<const u32>(sectionMasks));
 }
 
 bool BlockDrawCallNode::shouldExecute() const {
     return true;
 }
 
+bool BlockDrawCallNode::runsOnComputeQueue() const {
+    return m_config->asyncCompute;
+}
+
+std::vector<ResourceUsage> BlockDrawCallNode::getResourceUsages() const {
+    constexpr vk::PipelineStageFlags compute            = vk::PipelineStageFlagBits::eComputeShader;
+    constexpr vk::PipelineStageFlags computeAndTransfer = compute | vk::PipelineStageFlagBits::eTransfer;
+    constexpr vk::AccessFlags        shaderReadWrite    = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    constexpr vk::AccessFlags        resetAndReadWrite  = shaderReadWrite | vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eTransferRead;
+
+    // The section culling tests against the depth pyramid its frame in flight built the last time, which the forward pass rebuilds afterwards
+    return {
+      ResourceUsage {           GlobalBuffers::ChunkOrigin,  true, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite},
+      ResourceUsage {                  GlobalBuffers::Face,  true,                              compute,                    shaderReadWrite},
+      ResourceUsage {           GlobalBuffers::DrawCommand,  true,                              compute,    vk::AccessFlagBits::eShaderWrite},
+      ResourceUsage {             GlobalBuffers::DrawCount,  true,                   computeAndTransfer,                  resetAndReadWrite},
+      ResourceUsage {    GlobalBuffers::OcclusionCandidate,  true,                              compute,    vk::AccessFlagBits::eShaderWrite},
+      ResourceUsage {GlobalBuffers::OcclusionCandidateDraw,  true,                              compute,    vk::AccessFlagBits::eShaderWrite},
+      ResourceUsage {        GlobalBuffers::OcclusionCount,  true,                   computeAndTransfer,                  resetAndReadWrite},
+      ResourceUsage {          GlobalBuffers::DepthPyramid, false,                              compute,     vk::AccessFlagBits::eShaderRead},
+    };
+}
+
 IRenderingNode::ExecutionResult BlockDrawCallNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
     ZoneScoped;
 
     recompileShadersIfNecessary();
 
-    if (loadCountChunksLastFrame != m_config->loadCountChunks) {
+    // While the node was culled, e.g. for the greedy meshing, the changes of the world were consumed elsewhere
+    const bool culledMeanwhile = m_lastExecutedFrame != 0u && executionData.frameNumber != m_lastExecutedFrame + 1u;
+    m_lastExecutedFrame        = executionData.frameNumber;
+    m_config->loadCountChunks  = std::min(m_config->loadCountChunks, maxLoadCountChunks);
+    if (loadCountChunksLastFrame != m_config->loadCountChunks || culledMeanwhile) {
         recreateBlockDependentBuffers();
         recreatePipeline();
     }
+    plotDrawCounters();
 
-    const u32 oneDimensionChunkCount = 1 + m_config->loadCountChunks * 2u;
-    const u32 workGroupCount         = oneDimensionChunkCount * oneDimensionChunkCount;
-
-    updateBlockWorldData(executionData.camera->getPosition());
-    updateCullingData(executionData.camera);
+    // The renderer recreates the depth pyramid together with the swap chain
+    const bool poolRecreated = updateBlockWorldData(executionData.camera->getPosition());
+    if (poolRecreated || m_globalBufferVersion != m_renderer->getGlobalBufferVersion()) {
+        recreatePipeline();
+    }
+    const u32 cullingDataOffset       = updateCullingData(executionData.camera);
+    const u32 sectionVisibilityOffset = updateSectionVisibility(executionData.camera);
+    const u32 occlusionResetOffset    = m_renderer->getFrameAllocator().push(OcclusionCounters {});
 
-    std::array<const u32, 6> empty {0u, 1u, 0u, 0u, 0u, 0u};
-    copyToDevice<u32>(m_drawCommandBuffer.deviceMemory, std::span(empty));
+    const std::array offsets {
+      DynamicOffset {          cullingBindingPoint,       cullingDataOffset},
+      DynamicOffset {sectionVisibilityBindingPoint, sectionVisibilityOffset}
+    };
+    const auto dynamicOffsets = orderDynamicOffsets(m_slots, offsets);
 
+    auto& frameBuffers = m_frameBuffers [m_renderer->getFrameIndex()];
     {
         commandBuffer.begin(vk::CommandBufferBeginInfo());
         TracyVkZone(m_computeProfilerContext.context, *commandBuffer, "Generate Draw Calls");
         TracyVkCollect(m_computeProfilerContext.context, *commandBuffer);
 
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_computePipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *m_pipelineLayout, 0u, {*m_descriptorSet}, nullptr);
-        commandBuffer.dispatch(workGroupCount, BlockWorld::chunkHeight, 1);
+        auto& frameAllocator = m_renderer->getFrameAllocator();
+        commandBuffer.fillBuffer(*frameBuffers.drawCount.buffer, 0u, VK_WHOLE_SIZE, 0u);
+        commandBuffer.copyBuffer(
+          *frameAllocator.getBuffer().buffer, *frameBuffers.occlusionCount.buffer, vk::BufferCopy(occlusionResetOffset, 0u, sizeof(OcclusionCounters)));
+        if (m_staleSlotTables.test(m_renderer->getFrameIndex())) {
+            recordSlotTableCopies(commandBuffer, frameBuffers);
+        }
+        if (!m_generationLayers.empty()) {
+            const u32 remapOffset = frameAllocator.push(std::span<const u32>(m_generationLayers));
+            commandBuffer.copyBuffer(
+              *frameAllocator.getBuffer().buffer, *m_chunkRemapIndex.buffer, vk::BufferCopy(remapOffset, 0u, m_generationLayers.size() * sizeof(u32)));
+        }
+        if (!m_generationSlots.empty()) {
+            commandBuffer.fillBuffer(*m_faceCursorBuffer.buffer, 0u, VK_WHOLE_SIZE, 0u);
+        }
+        const vk::MemoryBarrier resetBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, resetBarrier, nullptr, nullptr);
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *m_pipelineLayout, 0u, {*frameBuffers.descriptorSet}, dynamicOffsets);
+
+        // Only chunks which are new or changed get their resident faces written again
+        if (!m_generationSlots.empty()) {
+            TracyVkZone(m_computeProfilerContext.context, *commandBuffer, "Regenerate Chunk Faces");
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_computePipeline);
+            commandBuffer.dispatch(static_cast<u32>(m_generationLayers.size()), 1, 1);
+
+            const vk::MemoryBarrier generationBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+            commandBuffer.pipelineBarrier(
+              vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, generationBarrier, nullptr, nullptr);
+        }
+
+        // Emits the draw commands of the sections inside the frustum, the forward pass draws straight from the resident faces
+        {
+            TracyVkZone(m_computeProfilerContext.context, *commandBuffer, "Cull Sections");
+            const u32 sectionCount = static_cast<u32>(m_residentChunks.size() * BlockWorld::sectionsPerChunk);
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_cullingPipeline);
+            commandBuffer.dispatch((sectionCount + sectionCullingGroupSize - 1u) / sectionCullingGroupSize, 1, 1);
+        }
+
+        const vk::MemoryBarrier counterBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, counterBarrier, nullptr, nullptr);
+        const vk::DeviceSize readbackOffset = m_renderer->getFrameIndex() * sizeof(DrawCounters);
+        commandBuffer.copyBuffer(*frameBuffers.drawCount.buffer, *m_counterReadback.buffer, vk::BufferCopy(0u, readbackOffset, sizeof(DrawCounters)));
+        const vk::MemoryBarrier readbackBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
     }
     commandBuffer.end();
 
-    return ExecutionResult {{}, m_renderer->getComputeQueue()};
+    const auto& queue = runsOnComputeQueue() ? m_renderer->getComputeQueue() : m_renderer->getGraphicsQueue();
+    return ExecutionResult {{vk::PipelineStageFlagBits::eComputeShader}, queue, m_worldDataUpload};
 }
 }   // namespace dnm
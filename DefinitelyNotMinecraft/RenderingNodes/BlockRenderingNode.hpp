@@ -1,5 +1,10 @@
 #pragma once
 
+#include <bitset>
+#include <optional>
+#include <unordered_map>
+
+#include <Core/BuddyAllocator.hpp>
 #include <Core/Config.hpp>
 #include <Core/GPUProfiller.hpp>
 #include <Core/Handle.hpp>
@@ -19,17 +24,65 @@ class BlockDrawCallNode : public IRenderingNode {
     public:
     explicit BlockDrawCallNode(Config* config, Renderer* renderer, ShaderManager* manager, BlockWorld* blockWorld, StringInterner* interner);
 
-    std::string_view getName() const override;
-    bool             shouldExecute() const override;
-    ExecutionResult  execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    std::string_view           getName() const override;
+    bool                       shouldExecute() const override;
+    std::vector<ResourceUsage> getResourceUsages() const override;
+    bool                       runsOnComputeQueue() const override;
+    ExecutionResult            execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
 
     private:
     void recreatePipeline();
     void recompileShadersIfNecessary(bool force = false);
 
+    // Every chunk of the window keeps its world data and exposed faces in a slot until it leaves the window
+    struct ResidentChunk
+    {
+        glm::ivec2 position {};
+        // Range of the resident face pool in faces, split into the sections from bottom to top and those into the face directions
+        u32                                                                            faceOffset = 0u;
+        u32                                                                            faceCount  = 0u;
+        std::array<u32, BlockWorld::sectionsPerChunk * BlockWorld::faceDirectionCount> rangeFaceCounts {};
+        // Layers which hold at least one exposed face, only those are dispatched when the chunk is regenerated
+        std::bitset<BlockWorld::chunkHeight>                                           exposedLayers {};
+        // Frames in flight whose copy of the resident faces misses the current faces of the chunk
+        std::bitset<Renderer::maxFramesInFlight>                                       pendingGeneration {};
+        bool                                                                           inUse = false;
+    };
+
+    // Everything the culling writes and the forward pass reads, so the culling of a frame never waits for the draws of the
+    // earlier frames. The resident faces are generated into each copy, the section ranges pointing into them are shared.
+    struct FrameBuffers
+    {
+        dnm::BufferData         chunkOrigin {nullptr};
+        dnm::BufferData         residentFaces {nullptr};
+        dnm::BufferData         drawCommands {nullptr};
+        dnm::BufferData         drawCount {nullptr};
+        dnm::BufferData         occlusionCandidates {nullptr};
+        dnm::BufferData         candidateDraws {nullptr};
+        dnm::BufferData         occlusionCount {nullptr};
+        vk::raii::DescriptorSet descriptorSet {nullptr};
+    };
+
+    // Registers the buffer of every frame in flight as the global buffer
+    std::unique_ptr<BufferRegistration> registerFrameBuffers(GlobalBuffers identifier, dnm::BufferData FrameBuffers::*member);
+
     void recreateBlockDependentBuffers();
+    void writeChunkConstants() const;
+    void plotDrawCounters() const;
+
+    u32  acquireSlot(glm::ivec2 chunk);
+    void releaseSlot(u32 slot);
+    bool allocateFaceRange(ResidentChunk& resident);
+    // Places every resident chunk in a new pool of at least this many faces and schedules their generation
+    void rebuildFacePool(u64 capacity);
+    // Copies the chunk origins of the frame in flight and the section face ranges of every slot from the frame allocator
+    void recordSlotTableCopies(const vk::raii::CommandBuffer& commandBuffer, FrameBuffers& frameBuffers);
+    // Uploads chunks which entered the window or changed, returns true if the resident face pool was recreated
     bool updateBlockWorldData(v3 cameraPosition);
-    void updateCullingData(const Camera* camera) const;
+    // Returns the offset of the culling data in the frame allocator
+    u32  updateCullingData(const Camera* camera) const;
+    // Returns the offset of the per slot masks of the sections the camera can see through air in the frame allocator
+    u32  updateSectionVisibility(const Camera* camera);
 
     Config*         m_config;
     Renderer*       m_renderer;
@@ -38,32 +91,57 @@ class BlockDrawCallNode : public IRenderingNode {
     StringInterner* m_interner;
 
     ShaderHandle m_computeHandle;
+    ShaderHandle m_cullingHandle;
 
     vk::raii::ShaderModule m_drawCallGenerationComputeModule {nullptr};
+    vk::raii::ShaderModule m_sectionCullingComputeModule {nullptr};
+
+    std::array<FrameBuffers, Renderer::maxFramesInFlight> m_frameBuffers;
 
-    dnm::BufferData m_transformBuffer {nullptr};
-    dnm::BufferData m_drawCommandBuffer {nullptr};
     dnm::BufferData m_worldDataBuffer {nullptr};
-    dnm::BufferData m_blockTypeBuffer {nullptr};
     dnm::BufferData m_chunkConstantsBuffer {nullptr};
     dnm::BufferData m_chunkRemapIndex {nullptr};
-    dnm::BufferData m_cullingData {nullptr};
+    dnm::BufferData m_sectionRangeBuffer {nullptr};
+    dnm::BufferData m_faceCursorBuffer {nullptr};
+    // One copy of the draw counters per frame in flight
+    dnm::BufferData m_counterReadback {nullptr};
 
-    std::unique_ptr<BufferRegistration> m_transformRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_chunkOriginRegistration {nullptr};
     std::unique_ptr<BufferRegistration> m_drawCommandRegistration {nullptr};
-    std::unique_ptr<BufferRegistration> m_blockTypeRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_drawCountRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_faceRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_occlusionCandidateRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_candidateDrawRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_occlusionCountRegistration {nullptr};
 
+    std::vector<BindingSlot>      m_slots;
     vk::raii::DescriptorSetLayout m_descriptorSetLayout {nullptr};
     vk::raii::PipelineLayout      m_pipelineLayout {nullptr};
 
-    vk::raii::DescriptorSet m_descriptorSet {nullptr};
-
     vk::raii::Pipeline m_computePipeline {nullptr};
+    vk::raii::Pipeline m_cullingPipeline {nullptr};
 
     GPUProfilerContext m_computeProfilerContext;
 
+    // Global buffers the descriptor set was written with
+    u32 m_globalBufferVersion = 0u;
+
     u32        loadCountChunksLastFrame = 0u;
     glm::ivec2 m_cameraChunkLastFrame {-10000, -10000};
     bool       m_allChunksUploadedLastFrame = false;
+    u64        m_lastExecutedFrame          = 0u;
+    // Frames in flight whose chunk origins are out of date, the section ranges are copied along
+    std::bitset<Renderer::maxFramesInFlight> m_staleSlotTables {};
+
+    UploadToken m_worldDataUpload {};
+
+    std::vector<ResidentChunk>          m_residentChunks;
+    std::unordered_map<glm::ivec2, u32> m_chunkSlots;
+    std::unordered_map<glm::ivec2, u8>  m_visibleSections;
+    std::vector<u32>                    m_freeSlots;
+    std::vector<u32>                    m_generationSlots;
+    // slot * chunkHeight + layer of every dispatched workgroup
+    std::vector<u32>                    m_generationLayers;
+    std::optional<BuddyAllocator>       m_facePool;
 };
 }   // namespace dnm
@@ -26,21 +26,42 @@ namespace
         float specularStrength;
     };
 
-    constexpr std::string_view vertexShader   = "Shaders/World.vert";
-    constexpr std::string_view fragmentShader = "Shaders/World.frag";
+    constexpr std::string_view vertexShader       = worldVertexShader.filePath;
+    constexpr std::string_view greedyVertexShader = greedyWorldVertexShader.filePath;
+    constexpr std::string_view fragmentShader     = worldFragmentShader.filePath;
 
     constexpr std::string_view lightConstantsBindingPoint = "lightConstants";
     constexpr std::string_view perLightBindingPoint       = "perLightBuffer";
 
+    constexpr u32 defaultLightCount = 3u;
+
+    // A draw covers the faces of one direction of a section and a block has at most one face per direction
+    constexpr u32 maxFacesPerDraw = static_cast<u32>(BlockWorld::perSectionBlockCount);
+
+    // Order of the results of the pipeline statistics query, which follows the order of the statistic bits
+    struct PipelineStatistics
+    {
+        u64 inputAssemblyVertices;
+        u64 vertexShaderInvocations;
+    };
+
 }   // namespace
 
 ForwardRenderingNode::ForwardRenderingNode(Config* config, Renderer* renderer, ShaderManager* shaderManager, BlockWorld* blockWorld, StringInterner* interner) :
-    m_config {config}, m_renderer {renderer}, m_shaderManager {shaderManager}, m_blockWorld {blockWorld}, m_interner {interner} {
-    const auto& physicalDevice = m_renderer->getPhysicalDevice();
-    const auto& device         = m_renderer->getDevice();
+    m_config {config},
+    m_renderer {renderer},
+    m_shaderManager {shaderManager},
+    m_blockWorld {blockWorld},
+    m_interner {interner},
+    m_occlusionCullingPass {config, renderer, shaderManager, interner} {
+    auto&       allocator = m_renderer->getMemoryAllocator();
+    const auto& device    = m_renderer->getDevice();
+
+    m_lateRenderPass = makeRenderPass(device, renderer->getColorFormat(), vk::Format::eD32Sfloat, vk::AttachmentLoadOp::eLoad);
 
-    m_vertexHandle   = m_shaderManager->registerShaderFile(m_interner->addOrGetString(vertexShader), vk::ShaderStageFlagBits::eVertex);
-    m_fragmentHandle = m_shaderManager->registerShaderFile(m_interner->addOrGetString(fragmentShader), vk::ShaderStageFlagBits::eFragment);
+    m_vertexHandle       = m_shaderManager->registerShaderFile(worldVertexShader);
+    m_greedyVertexHandle = m_shaderManager->registerShaderFile(greedyWorldVertexShader);
+    m_fragmentHandle     = m_shaderManager->registerShaderFile(worldFragmentShader);
 
     int      texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load("Textures/TextureSheet.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -50,8 +71,7 @@ ForwardRenderingNode::ForwardRenderingNode(Config* config, Renderer* renderer, S
     const u32 mipLevels = static_cast<u32>(std::floor(std::log2(std::max(texWidth, texHeight)))) - 3;
 
     m_textureData = TextureData(
-      physicalDevice,
-      device,
+      allocator,
       vk::Extent2D(texWidth, texHeight),
       vk::Format::eR8G8B8A8Unorm,
       vk::SamplerAddressMode::eClampToEdge,
@@ -59,98 +79,55 @@ ForwardRenderingNode::ForwardRenderingNode(Config* config, Renderer* renderer, S
       vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
       {},
       false,
-      true);
-    m_renderer->oneTimeSubmit(
-      [&](const vk::raii::CommandBuffer& commandBuffer)
-      {
-          m_textureData.setImage(commandBuffer, pixels, false, mipLevels);
-
-          vk::ImageMemoryBarrier barrier {};
-          barrier.image                           = *m_textureData.imageData.image;
-          barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-          barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-          barrier.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
-          barrier.subresourceRange.baseArrayLayer = 0;
-          barrier.subresourceRange.layerCount     = 1;
-          barrier.subresourceRange.levelCount     = 1;
-
-          i32 mipWidth  = texWidth;
-          i32 mipHeight = texHeight;
-
-          for (u32 i = 1; i < mipLevels; i++) {
-              barrier.subresourceRange.baseMipLevel = i - 1;
-              barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
-              barrier.newLayout                     = vk::ImageLayout::eTransferSrcOptimal;
-              barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
-              barrier.dstAccessMask                 = vk::AccessFlagBits::eTransferRead;
-
-              commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-
-              std::array srcOffsets {
-                vk::Offset3D {       0,         0, 0},
-                 vk::Offset3D {mipWidth, mipHeight, 1}
-              };
-              std::array dstOffsets {
-                vk::Offset3D {                              0,                                 0, 0},
-                 vk::Offset3D {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1}
-              };
-
-              vk::ImageBlit blit {
-                {vk::ImageAspectFlagBits::eColor, i - 1, 0, 1},
-                srcOffsets, {vk::ImageAspectFlagBits::eColor,     i, 0, 1},
-                dstOffsets
-              };
-
-              commandBuffer.blitImage(
-                *m_textureData.imageData.image,
-                vk::ImageLayout::eTransferSrcOptimal,
-                *m_textureData.imageData.image,
-                vk::ImageLayout::eTransferDstOptimal,
-                blit,
-                vk::Filter::eLinear);
-
-              barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
-              barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
-              barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-              barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-              commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
-
-              if (mipWidth > 1) {
-                  mipWidth /= 2;
-              }
-              if (mipHeight > 1) {
-                  mipHeight /= 2;
-              }
-          }
-
-          barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-          barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
-          barrier.newLayout                     = vk::ImageLayout::eShaderReadOnlyOptimal;
-          barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
-          barrier.dstAccessMask                 = vk::AccessFlagBits::eShaderRead;
-
-          commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
-
-          stbi_image_free(pixels);
-      });
+      true,
+      m_renderer->getSharingFamilies());
+    // The uploader stages the pixels itself
+    m_textureData.stagingBufferData = nullptr;
+    m_mipLevels                     = mipLevels;
+
+    const UploadToken textureUpload = m_renderer->getUploader().uploadImage(
+      m_textureData.imageData,
+      m_textureData.extent,
+      std::as_bytes(std::span<const stbi_uc>(pixels, static_cast<size_t>(texWidth) * texHeight * 4u)));
+    stbi_image_free(pixels);
     registerDebugMarker(device, m_textureData.imageData.image, "TextureSheet");
 
+    // Every face reuses two of its four corners, so the vertex cache only shades them once
+    std::vector<u32> quadIndices(static_cast<u64>(maxFacesPerDraw) * 6u);
+    for (u32 face = 0u; face < maxFacesPerDraw; ++face) {
+        constexpr std::array<u32, 6> quadCorners {0u, 1u, 2u, 2u, 3u, 0u};
+        for (u32 i = 0u; i < quadCorners.size(); ++i) {
+            quadIndices [face * 6u + i] = face * 4u + quadCorners [i];
+        }
+    }
+    m_quadIndexBuffer = m_renderer->createBuffer(
+      quadIndices.size() * sizeof(u32),
+      vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Quad Indices",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+    const UploadToken indexUpload = m_renderer->getUploader().upload(m_quadIndexBuffer, std::span<const u32>(quadIndices));
+    // Values of the uploader's timeline only grow, so waiting on the later one covers both
+    m_staticUpload = UploadToken {std::max(textureUpload.value, indexUpload.value)};
+
+    if (m_renderer->getPhysicalDevice().getFeatures().pipelineStatisticsQuery) {
+        m_statisticsQueryPool = vk::raii::QueryPool(
+          device,
+          vk::QueryPoolCreateInfo(
+            {},
+            vk::QueryType::ePipelineStatistics,
+            Renderer::maxFramesInFlight,
+            vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices | vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations));
+    }
+
     m_renderingProfilerContext = GPUProfilerContext(m_renderer);
 
-    m_lightConstants = m_renderer->createBuffer(
-      sizeof(LightConstants),
-      vk::BufferUsageFlagBits::eUniformBuffer,
-      "Light Constants",
-      vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
+    constexpr u32 perLightCount  = TestLights ? lightLength * lightLength : defaultLightCount;
+    auto&         frameAllocator = m_renderer->getFrameAllocator();
+    m_viewDataReservation        = frameAllocator.reserve(sizeof(Camera::ViewData));
+    m_lightConstantsReservation  = frameAllocator.reserve(sizeof(LightConstants));
+    m_perLightReservation        = frameAllocator.reserve(sizeof(PerLightBuffer) * perLightCount);
 
     if constexpr (TestLights) {
-        m_perLightBuffer = m_renderer->createBuffer(
-          sizeof(PerLightBuffer) * lightLength * lightLength,
-          vk::BufferUsageFlagBits::eStorageBuffer,
-          "Light Buffer",
-          vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
-
         std::random_device               rd;          
         std::mt19937                     gen(rd());  
         std::uniform_real_distribution<> dis(0.0, 1.0);
@@ -166,13 +143,6 @@ ForwardRenderingNode::ForwardRenderingNode(Config* config, Renderer* renderer, S
             }
         }
     }
-    else {
-        m_perLightBuffer = m_renderer->createBuffer(
-          sizeof(PerLightBuffer) * 3,
-          vk::BufferUsageFlagBits::eStorageBuffer,
-          "Light Buffer",
-          vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible);
-    }
 
     recompileShadersIfNecessary(true);
 }
@@ -185,13 +155,91 @@ bool ForwardRenderingNode::shouldExecute() const {
     return true;
 }
 
-IRenderingNode::ExecutionResult ForwardRenderingNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
-    ZoneScoped;
+std::vector<ResourceUsage> ForwardRenderingNode::getResourceUsages() const {
+    constexpr vk::PipelineStageFlags vertex   = vk::PipelineStageFlagBits::eVertexShader;
+    constexpr vk::PipelineStageFlags indirect = vk::PipelineStageFlagBits::eDrawIndirect;
+    constexpr vk::PipelineStageFlags compute  = vk::PipelineStageFlagBits::eComputeShader;
+    constexpr vk::AccessFlags        read     = vk::AccessFlagBits::eShaderRead;
+    constexpr vk::AccessFlags        command  = vk::AccessFlagBits::eIndirectCommandRead;
+
+    std::vector<ResourceUsage> usages {
+      ResourceUsage {Attachment::SwapChain, true, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlagBits::eColorAttachmentWrite},
+      ResourceUsage {
+                     Attachment::Depth, true,
+                     vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eTransfer,
+                     vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eTransferRead},
+      ResourceUsage {GlobalBuffers::ProjectionClip, false, vertex, vk::AccessFlagBits::eUniformRead},
+    };
+
+    if (m_config->greedyMeshing) {
+        usages.push_back({GlobalBuffers::GreedyChunkOrigin, false, vertex, read});
+        usages.push_back({GlobalBuffers::GreedyQuad, false, vertex, read});
+        usages.push_back({GlobalBuffers::GreedyDrawCommand, false, indirect, command});
+        usages.push_back({GlobalBuffers::GreedyDrawCount, false, indirect, command});
+    }
+    else {
+        usages.push_back({GlobalBuffers::ChunkOrigin, false, vertex, read});
+        usages.push_back({GlobalBuffers::Face, false, vertex, read});
+        usages.push_back({GlobalBuffers::DrawCommand, false, indirect, command});
+        usages.push_back({GlobalBuffers::DrawCount, false, indirect, command});
+    }
+
+    if (m_config->occlusionCullingEnabled) {
+        usages.push_back(
+          {GlobalBuffers::DepthPyramid,
+           true,
+           compute | vk::PipelineStageFlagBits::eTransfer,
+           read | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite});
+
+        // The late culling tests the candidates of the section culling and draws from their counters
+        if (!m_config->greedyMeshing) {
+            usages.push_back({GlobalBuffers::OcclusionCandidate, false, compute, read});
+            usages.push_back({GlobalBuffers::OcclusionCandidateDraw, false, compute, read});
+            usages.push_back(
+              {GlobalBuffers::OcclusionCount,
+               true,
+               compute | indirect | vk::PipelineStageFlagBits::eTransfer,
+               read | command | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead});
+        }
+    }
+
+    return usages;
+}
 
-    auto& frameBuffer = m_renderer->getFrameBuffer(executionData.frameBufferIndex);
+void ForwardRenderingNode::prepareExecution(const ExecutionData& executionData) {
+    ZoneScoped;
 
     recompileShadersIfNecessary();
-    const auto extent = m_renderer->getExtent();
+    if (m_config->occlusionCullingEnabled) {
+        m_occlusionCullingPass.prepare(executionData.camera, !m_config->greedyMeshing);
+    }
+
+    const u32 frameIndex = m_renderer->getFrameIndex();
+    if (*m_statisticsQueryPool) {
+        plotPipelineStatistics(frameIndex);
+        m_statisticsWritten [frameIndex] = true;
+    }
+    writeFrameData(executionData.camera, frameIndex);
+
+    const RecordingInputs inputs {
+      m_config->greedyMeshing, m_config->occlusionCullingEnabled, m_mipChainGenerated, m_occlusionCullingPass.getRecordingVersion()};
+    if (inputs != m_recordingInputs) {
+        m_recordingInputs = inputs;
+        ++m_recordingVersion;
+    }
+}
+
+std::optional<u64> ForwardRenderingNode::getStaticVersion() const {
+    if (!m_config->staticForwardPass) {
+        return std::nullopt;
+    }
+    // The draw call nodes recorded before this one may recreate the global buffers
+    return (static_cast<u64>(m_recordingVersion) << 32u) | m_renderer->getGlobalBufferVersion();
+}
+
+void ForwardRenderingNode::writeFrameData(const Camera* camera, u32 frameIndex) {
+    auto& frameAllocator = m_renderer->getFrameAllocator();
+    frameAllocator.write(m_viewDataReservation, frameIndex, camera->getViewData());
 
     if constexpr (TestLights) {
         auto now = std::chrono::system_clock::now();
@@ -199,27 +247,48 @@ IRenderingNode::ExecutionResult ForwardRenderingNode::execute(const ExecutionDat
             perLight.lightPos.y = 170.0f - ((now.time_since_epoch().count() % 10000000) / 10000000.0f) * 100.0f;
         }
 
-        copyToDevice(m_perLightBuffer.deviceMemory, std::span<const PerLightBuffer> {lightTest.data(), lightLength * lightLength});
+        frameAllocator.write(m_perLightReservation, frameIndex, std::span<const PerLightBuffer> {lightTest.data(), lightLength * lightLength});
         LightConstants constants {
           lightLength * lightLength, m_config->specularPow, m_config->smoothstepMax, m_config->ambientStrength, m_config->specularStrength};
-        copyToDevice(m_lightConstants.deviceMemory, std::span<const LightConstants> {&constants, 1u});
+        frameAllocator.write(m_lightConstantsReservation, frameIndex, constants);
     }
     else {
-        if (m_config->updateLight) {
-
-            std::array buffer {
-              PerLightBuffer { m_config->lightColor, 0.0f,  m_config->lightPosition},
-              PerLightBuffer {m_config->lightColor2, 0.0f, m_config->lightPosition2},
-              PerLightBuffer {m_config->lightColor3, 0.0f, m_config->lightPosition3}
-            };
-            copyToDevice(m_perLightBuffer.deviceMemory, std::span<const PerLightBuffer> {buffer.data(), 3u});
-            LightConstants constants {
-              m_config->lightCount, m_config->specularPow, m_config->smoothstepMax, m_config->ambientStrength, m_config->specularStrength};
-            copyToDevice(m_lightConstants.deviceMemory, std::span<const LightConstants> {&constants, 1u});
-            m_config->updateLight = false;
-        }
+        std::array buffer {
+          PerLightBuffer { m_config->lightColor, 0.0f,  m_config->lightPosition},
+          PerLightBuffer {m_config->lightColor2, 0.0f, m_config->lightPosition2},
+          PerLightBuffer {m_config->lightColor3, 0.0f, m_config->lightPosition3}
+        };
+        frameAllocator.write(m_perLightReservation, frameIndex, std::span<const PerLightBuffer> {buffer.data(), defaultLightCount});
+        LightConstants constants {
+          m_config->lightCount, m_config->specularPow, m_config->smoothstepMax, m_config->ambientStrength, m_config->specularStrength};
+        frameAllocator.write(m_lightConstantsReservation, frameIndex, constants);
+    }
+}
+
+IRenderingNode::ExecutionResult ForwardRenderingNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
+    ZoneScoped;
+
+    const u32 frameIndex = m_renderer->getFrameIndex();
+    if (m_globalBufferVersions [frameIndex] != m_renderer->getGlobalBufferVersion()) {
+        writeBlockDescriptorSet(m_facePipeline, frameIndex);
+        writeBlockDescriptorSet(m_greedyPipeline, frameIndex);
+        m_globalBufferVersions [frameIndex] = m_renderer->getGlobalBufferVersion();
     }
 
+    auto&       frameBuffer    = m_renderer->getFrameBuffer(executionData.frameBufferIndex);
+    const auto  extent         = m_renderer->getExtent();
+    const auto& frameAllocator = m_renderer->getFrameAllocator();
+    // Tracy's GPU zones can't be submitted twice, the render graph's timestamps still measure a reused recording
+    const bool  profileZones   = !getStaticVersion();
+
+    const std::array offsets {
+      DynamicOffset {    viewBufferBindingPoint,       frameAllocator.getReserved(m_viewDataReservation, frameIndex).offset},
+      DynamicOffset {lightConstantsBindingPoint, frameAllocator.getReserved(m_lightConstantsReservation, frameIndex).offset},
+      DynamicOffset {      perLightBindingPoint,       frameAllocator.getReserved(m_perLightReservation, frameIndex).offset}
+    };
+    const auto& blockPipeline  = m_config->greedyMeshing ? m_greedyPipeline : m_facePipeline;
+    const auto  dynamicOffsets = orderDynamicOffsets(blockPipeline.slots, offsets);
+
     {
         std::array<vk::ClearValue, 2> clearValues;
         clearValues [0].color        = vk::ClearColorValue(0.2f, 0.2f, 0.2f, 0.2f);
@@ -227,52 +296,230 @@ IRenderingNode::ExecutionResult ForwardRenderingNode::execute(const ExecutionDat
 
         const auto&                   pass = m_renderer->getRenderPass();
         const vk::RenderPassBeginInfo renderPassBeginInfo(*pass, *frameBuffer, vk::Rect2D(vk::Offset2D(0, 0), extent), clearValues);
+        const vk::RenderPassBeginInfo lateRenderPassBeginInfo(*m_lateRenderPass, *frameBuffer, vk::Rect2D(vk::Offset2D(0, 0), extent), clearValues);
 
-        commandBuffer.reset();
+        auto bindBlockPipeline = [&]()
         {
-            commandBuffer.begin(vk::CommandBufferBeginInfo());
-            TracyVkZone(m_renderingProfilerContext.context, *commandBuffer, "Draw Blocks");
-            TracyVkCollect(m_renderingProfilerContext.context, *commandBuffer);
-
-            commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_graphicsPipeline);
-            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_pipelineLayout, 0, {*m_descriptorSet}, nullptr);
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *blockPipeline.pipeline);
+            commandBuffer.bindDescriptorSets(
+              vk::PipelineBindPoint::eGraphics, *blockPipeline.pipelineLayout, 0, {*blockPipeline.descriptorSets [frameIndex]}, dynamicOffsets);
+            if (!m_config->greedyMeshing) {
+                commandBuffer.bindIndexBuffer(*m_quadIndexBuffer.buffer, 0u, vk::IndexType::eUint32);
+            }
 
             commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 1.0f, 0.0f));
             commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
-            auto* buffer = m_renderer->getGlobalBuffer(GlobalBuffers::DrawCommand);
-            commandBuffer.drawIndirect(**buffer, 0u, 1u, sizeof(u32) * 4);
+        };
+
+        {
+            commandBuffer.begin(vk::CommandBufferBeginInfo());
+            TracyVkNamedZone(m_renderingProfilerContext.context, drawBlocksZone, *commandBuffer, "Draw Blocks", profileZones);
+            if (profileZones) {
+                TracyVkCollect(m_renderingProfilerContext.context, *commandBuffer);
+            }
+
+            if (!m_mipChainGenerated) {
+                generateMipChain(commandBuffer);
+                m_mipChainGenerated = true;
+            }
+
+            if (*m_statisticsQueryPool) {
+                commandBuffer.resetQueryPool(*m_statisticsQueryPool, frameIndex, 1u);
+                commandBuffer.beginQuery(*m_statisticsQueryPool, frameIndex, {});
+            }
+
+            commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+            bindBlockPipeline();
+            if (m_config->greedyMeshing) {
+                // One draw per chunk with quads, the greedy meshing node writes how many there are
+                auto* commands = m_renderer->getGlobalBuffer(GlobalBuffers::GreedyDrawCommand);
+                auto* count    = m_renderer->getGlobalBuffer(GlobalBuffers::GreedyDrawCount);
+                commandBuffer.drawIndirectCount(**commands, 0u, **count, 0u, maxChunkSlots, sizeof(vk::DrawIndirectCommand));
+            }
+            else {
+                // One draw per visible section, the culling pass writes how many there are
+                auto* commands = m_renderer->getGlobalBuffer(GlobalBuffers::DrawCommand);
+                auto* count    = m_renderer->getGlobalBuffer(GlobalBuffers::DrawCount);
+                commandBuffer.drawIndexedIndirectCount(**commands, 0u, **count, 0u, maxSectionDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+            }
 
             commandBuffer.endRenderPass();
+
+            // The greedy meshes are not occlusion culled, but their depth keeps the pyramid current for switching back
+            if (m_config->occlusionCullingEnabled) {
+                TracyVkNamedZone(m_renderingProfilerContext.context, occlusionZone, *commandBuffer, "Occlusion Culling", profileZones);
+                m_occlusionCullingPass.record(commandBuffer, !m_config->greedyMeshing);
+            }
+
+            // Sections which an earlier frame's depth hid, but the early draws of this frame don't
+            if (m_config->occlusionCullingEnabled && !m_config->greedyMeshing) {
+                commandBuffer.beginRenderPass(lateRenderPassBeginInfo, vk::SubpassContents::eInline);
+                bindBlockPipeline();
+
+                auto* count = m_renderer->getGlobalBuffer(GlobalBuffers::OcclusionCount);
+                commandBuffer.drawIndexedIndirectCount(
+                  *m_occlusionCullingPass.getLateDrawCommands(),
+                  0u,
+                  **count,
+                  offsetof(OcclusionCounters, lateDrawCount),
+                  maxSectionDrawCount,
+                  sizeof(vk::DrawIndexedIndirectCommand));
+
+                commandBuffer.endRenderPass();
+            }
+
+            if (*m_statisticsQueryPool) {
+                commandBuffer.endQuery(*m_statisticsQueryPool, frameIndex);
+            }
         }
         commandBuffer.end();
     }
 
-    return ExecutionResult {{vk::PipelineStageFlagBits::eColorAttachmentOutput}, m_renderer->getGraphicsQueue()};
+    // The draw commands and faces of the previous nodes are consumed from the indirect stage on, the occlusion culling
+    // also dispatches from the counters of the section culling and rewrites the depth pyramid it reads
+    return ExecutionResult {
+      {vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer},
+      m_renderer->getGraphicsQueue(),
+      m_staticUpload};
+}
+
+void ForwardRenderingNode::plotPipelineStatistics(u32 frameIndex) const {
+    if (!m_statisticsWritten [frameIndex]) {
+        return;
+    }
+
+    // The fence of the frame which last wrote this query was already waited on
+    const auto [result, statistics] =
+      m_statisticsQueryPool.getResult<PipelineStatistics>(frameIndex, 1u, sizeof(PipelineStatistics), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    TracyPlot("Input Assembly Vertices", static_cast<i64>(statistics.inputAssemblyVertices));
+    TracyPlot("Vertex Shader Invocations", static_cast<i64>(statistics.vertexShaderInvocations));
+    TracyPlot(
+      "Vertex Reuse %",
+      statistics.inputAssemblyVertices > 0u ? 100.0 * (1.0 - static_cast<double>(statistics.vertexShaderInvocations) / statistics.inputAssemblyVertices) : 0.0);
+}
+
+void ForwardRenderingNode::generateMipChain(const vk::raii::CommandBuffer& commandBuffer) const {
+    ZoneScoped;
+    const auto& image = m_textureData.imageData.image;
+
+    // The uploader only wrote the base level, the others are blitted from it
+    for (u32 mipLevel = 1; mipLevel < m_mipLevels; ++mipLevel) {
+        setImageLayout(commandBuffer, *image, m_textureData.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevel);
+    }
+
+    vk::ImageMemoryBarrier barrier {};
+    barrier.image                           = *image;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+    barrier.subresourceRange.levelCount     = 1;
+
+    i32 mipWidth  = static_cast<i32>(m_textureData.extent.width);
+    i32 mipHeight = static_cast<i32>(m_textureData.extent.height);
+
+    for (u32 i = 1; i < m_mipLevels; i++) {
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout                     = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask                 = vk::AccessFlagBits::eTransferRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+
+        std::array srcOffsets {
+          vk::Offset3D {       0,         0, 0},
+           vk::Offset3D {mipWidth, mipHeight, 1}
+        };
+        std::array dstOffsets {
+          vk::Offset3D {                              0,                                 0, 0},
+           vk::Offset3D {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1}
+        };
+
+        vk::ImageBlit blit {
+          {vk::ImageAspectFlagBits::eColor, i - 1, 0, 1},
+          srcOffsets, {vk::ImageAspectFlagBits::eColor,     i, 0, 1},
+          dstOffsets
+        };
+
+        commandBuffer.blitImage(*image, vk::ImageLayout::eTransferSrcOptimal, *image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+        barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+
+        if (mipWidth > 1) {
+            mipWidth /= 2;
+        }
+        if (mipHeight > 1) {
+            mipHeight /= 2;
+        }
+    }
+
+    barrier.subresourceRange.baseMipLevel = m_mipLevels - 1;
+    barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout                     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask                 = vk::AccessFlagBits::eShaderRead;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
 }
 
 void ForwardRenderingNode::recreatePipeline() {
     m_renderer->waitIdle();
 
+    createBlockPipeline(
+      m_facePipeline, vertexShader, m_vertexShaderModule, GlobalBuffers::ChunkOrigin, GlobalBuffers::Face, faceBindingPoint, "Block Rendering Graphics Pipeline");
+    createBlockPipeline(
+      m_greedyPipeline,
+      greedyVertexShader,
+      m_greedyVertexShaderModule,
+      GlobalBuffers::GreedyChunkOrigin,
+      GlobalBuffers::GreedyQuad,
+      quadBindingPoint,
+      "Greedy Block Rendering Graphics Pipeline");
+
+    m_globalBufferVersions.fill(m_renderer->getGlobalBufferVersion());
+    ++m_recordingVersion;
+}
+
+void ForwardRenderingNode::createBlockPipeline(
+  BlockPipeline&                blockPipeline,
+  std::string_view              vertexShaderFile,
+  const vk::raii::ShaderModule& vertexShaderModule,
+  GlobalBuffers                 chunkOriginBuffer,
+  GlobalBuffers                 faceBuffer,
+  std::string_view              faceBufferBindingPoint,
+  std::string_view              debugName) {
     std::vector<BindingSlot> slots;
     vk::ShaderStageFlags     stageFlags;
-    std::array               internedString {m_interner->addOrGetString(vertexShader), m_interner->addOrGetString(fragmentShader)};
+    std::array               internedString {m_interner->addOrGetString(vertexShaderFile), m_interner->addOrGetString(fragmentShader)};
     m_shaderManager->getBindingSlots(internedString, slots, stageFlags);
+    std::array dynamicSlots {viewBufferBindingPoint, lightConstantsBindingPoint, perLightBindingPoint};
+    makeSlotsDynamic(slots, dynamicSlots);
     const auto& device = m_renderer->getDevice();
 
-    m_descriptorSet.clear();
+    blockPipeline.descriptorSets.clear();
 
-    m_descriptorSetLayout = makeDescriptorSetLayout(device, slots, stageFlags);
-    m_pipelineLayout      = vk::raii::PipelineLayout(device, {{}, *m_descriptorSetLayout});
+    blockPipeline.descriptorSetLayout = makeDescriptorSetLayout(device, slots, stageFlags);
+    blockPipeline.pipelineLayout      = vk::raii::PipelineLayout(device, {{}, *blockPipeline.descriptorSetLayout});
 
-    auto sets       = vk::raii::DescriptorSets(device, {*m_renderer->getDescriptorPool(), *m_descriptorSetLayout});
-    m_descriptorSet = std::move(sets.front());
+    const std::vector<vk::DescriptorSetLayout> layouts(Renderer::maxFramesInFlight, *blockPipeline.descriptorSetLayout);
+    blockPipeline.descriptorSets = vk::raii::DescriptorSets(device, {*m_renderer->getDescriptorPool(), layouts});
 
-    m_graphicsPipeline = makeGraphicsPipeline(
+    blockPipeline.pipeline = makeGraphicsPipeline(
       m_config,
       device,
       m_renderer->getPipelineCache(),
-      m_vertexShaderModule,
+      vertexShaderModule,
       nullptr,
       m_fragmentShaderModule,
       nullptr,
@@ -280,33 +527,44 @@ void ForwardRenderingNode::recreatePipeline() {
       {},
       vk::FrontFace::eCounterClockwise,
       true,
-      m_pipelineLayout,
+      blockPipeline.pipelineLayout,
       m_renderer->getRenderPass());
-    registerDebugMarker(device, m_graphicsPipeline, "Block Rendering Graphics Pipeline");
+    registerDebugMarker(device, blockPipeline.pipeline, debugName);
+    m_renderer->markPipelineCacheDirty();
+
+    blockPipeline.slots                  = std::move(slots);
+    blockPipeline.chunkOriginBuffer      = chunkOriginBuffer;
+    blockPipeline.faceBuffer             = faceBuffer;
+    blockPipeline.faceBufferBindingPoint = faceBufferBindingPoint;
+    for (u32 frameIndex = 0u; frameIndex < Renderer::maxFramesInFlight; ++frameIndex) {
+        writeBlockDescriptorSet(blockPipeline, frameIndex);
+    }
+}
 
+void ForwardRenderingNode::writeBlockDescriptorSet(BlockPipeline& blockPipeline, u32 frameIndex) {
     const auto* projectionClipBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::ProjectionClip);
     assert(projectionClipBuffer);
-    const auto* viewBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::CameraView);
-    assert(viewBuffer);
-    const auto* blockType = m_renderer->getGlobalBuffer(GlobalBuffers::BlockType);
-    assert(blockType);
-    const auto* transform = m_renderer->getGlobalBuffer(GlobalBuffers::Transform);
-    assert(transform);
+    const auto* faces = m_renderer->getGlobalBuffer(blockPipeline.faceBuffer, frameIndex);
+    assert(faces);
+    const auto* chunkOrigins = m_renderer->getGlobalBuffer(blockPipeline.chunkOriginBuffer, frameIndex);
+    assert(chunkOrigins);
 
-    std::array update {
-      DescriptorSlotUpdate {projectionBufferBindingPoint,   *projectionClipBuffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {      viewBufferBindingPoint,             *viewBuffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {       transformBindingPoint,              *transform, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {       blockTypeBindingPoint,              *blockType, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {  lightConstantsBindingPoint, m_lightConstants.buffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {        perLightBindingPoint, m_perLightBuffer.buffer, VK_WHOLE_SIZE, nullptr},
-    };
+    const auto&   frameBuffer   = m_renderer->getFrameAllocator().getBuffer().buffer;
+    constexpr u32 perLightCount = TestLights ? lightLength * lightLength : defaultLightCount;
 
     std::array textureUpdate {
       TextureSlotUpdate {"tex;", m_textureData}
     };
 
-    updateDescriptorSets(device, m_descriptorSet, update, slots, textureUpdate);
+    std::array update {
+      DescriptorSlotUpdate {         projectionBufferBindingPoint, *projectionClipBuffer,                          VK_WHOLE_SIZE, nullptr},
+      DescriptorSlotUpdate {               viewBufferBindingPoint,           frameBuffer,               sizeof(Camera::ViewData), nullptr},
+      DescriptorSlotUpdate {              chunkOriginBindingPoint,         *chunkOrigins,                          VK_WHOLE_SIZE, nullptr},
+      DescriptorSlotUpdate {blockPipeline.faceBufferBindingPoint,                *faces,                          VK_WHOLE_SIZE, nullptr},
+      DescriptorSlotUpdate {           lightConstantsBindingPoint,           frameBuffer,                 sizeof(LightConstants), nullptr},
+      DescriptorSlotUpdate {                 perLightBindingPoint,           frameBuffer, sizeof(PerLightBuffer) * perLightCount, nullptr},
+    };
+    updateDescriptorSets(m_renderer->getDevice(), blockPipeline.descriptorSets [frameIndex], update, blockPipeline.slots, textureUpdate);
 }
 
 void ForwardRenderingNode::recompileShadersIfNecessary(bool force) {
@@ -317,7 +575,7 @@ void ForwardRenderingNode::recompileShadersIfNecessary(bool force) {
     auto processShader = [this, &device, &anyUpdated, &force](ShaderHandle handle, vk::raii::ShaderModule& shaderModule)
     {
         if (m_shaderManager->wasContentUpdated(handle) || force) {
-            auto recompiledVertexShader = m_shaderManager->getCompiledVersion(device, handle, {});
+            auto recompiledVertexShader = m_shaderManager->getCompiledVersion(device, handle);
             if (recompiledVertexShader) {
                 anyUpdated   = true;
                 shaderModule = std::move(recompiledVertexShader.value());
@@ -326,6 +584,7 @@ void ForwardRenderingNode::recompileShadersIfNecessary(bool force) {
     };
 
     processShader(m_vertexHandle, m_vertexShaderModule);
+    processShader(m_greedyVertexHandle, m_greedyVertexShaderModule);
     processShader(m_fragmentHandle, m_fragmentShaderModule);
 
     if (anyUpdated) {
@@ -8,6 +8,7 @@
 
 #include <Rendering/Renderer.hpp>
 #include <RenderingNodes/IRenderingNode.hpp>
+#include <RenderingNodes/OcclusionCullingPass.hpp>
 
 namespace dnm
 {
@@ -19,13 +20,54 @@ class ForwardRenderingNode : public IRenderingNode {
     public:
     explicit ForwardRenderingNode(Config* config, Renderer* renderer, ShaderManager* manager, BlockWorld* blockWorld, StringInterner* interner);
 
-    std::string_view getName() const override;
-    bool             shouldExecute() const override;
-    ExecutionResult  execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    std::string_view           getName() const override;
+    bool                       shouldExecute() const override;
+    std::vector<ResourceUsage> getResourceUsages() const override;
+    void                       prepareExecution(const ExecutionData& executionData) override;
+    ExecutionResult            execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    std::optional<u64>         getStaticVersion() const override;
 
     private:
+    // Per face and greedy meshed blocks only differ in the vertex shader and the buffers it reads
+    struct BlockPipeline
+    {
+        std::vector<BindingSlot>             slots;
+        vk::raii::DescriptorSetLayout        descriptorSetLayout {nullptr};
+        vk::raii::PipelineLayout             pipelineLayout {nullptr};
+        // One per frame in flight, the faces and chunk origins may be kept per frame in flight
+        std::vector<vk::raii::DescriptorSet> descriptorSets;
+        vk::raii::Pipeline                   pipeline {nullptr};
+        GlobalBuffers                        chunkOriginBuffer = GlobalBuffers::Undefined;
+        GlobalBuffers                        faceBuffer        = GlobalBuffers::Undefined;
+        std::string_view                     faceBufferBindingPoint;
+    };
+
+    // Everything besides the pipelines which changes what execute records
+    struct RecordingInputs
+    {
+        bool greedyMeshing           = false;
+        bool occlusionCullingEnabled = false;
+        bool mipChainGenerated       = false;
+        u32  occlusionVersion        = 0u;
+
+        bool operator==(const RecordingInputs&) const = default;
+    };
+
+    void writeFrameData(const Camera* camera, u32 frameIndex);
     void recreatePipeline();
+    void createBlockPipeline(
+      BlockPipeline&                blockPipeline,
+      std::string_view              vertexShaderFile,
+      const vk::raii::ShaderModule& vertexShaderModule,
+      GlobalBuffers                 chunkOriginBuffer,
+      GlobalBuffers                 faceBuffer,
+      std::string_view              faceBufferBindingPoint,
+      std::string_view              debugName);
+    // The set of a frame in flight is only written while none of its submissions is pending
+    void writeBlockDescriptorSet(BlockPipeline& blockPipeline, u32 frameIndex);
     void recompileShadersIfNecessary(bool force = false);
+    void generateMipChain(const vk::raii::CommandBuffer& commandBuffer) const;
+    void plotPipelineStatistics(u32 frameIndex) const;
 
     private:
     Config*         m_config;
@@ -35,24 +77,44 @@ class ForwardRenderingNode : public IRenderingNode {
     StringInterner* m_interner;
 
     ShaderHandle m_vertexHandle;
+    ShaderHandle m_greedyVertexHandle;
     ShaderHandle m_fragmentHandle;
 
     vk::raii::ShaderModule m_vertexShaderModule {nullptr};
+    vk::raii::ShaderModule m_greedyVertexShaderModule {nullptr};
     vk::raii::ShaderModule m_fragmentShaderModule {nullptr};
 
-    dnm::BufferData  m_lightConstants {nullptr};
-    dnm::BufferData  m_perLightBuffer {nullptr};
     dnm::TextureData m_textureData {nullptr};
+    u32              m_mipLevels {1u};
+    bool             m_mipChainGenerated {false};
+    // Texture sheet and quad indices, which are uploaded once
+    UploadToken      m_staticUpload {};
+
+    dnm::BufferData m_quadIndexBuffer {nullptr};
 
-    vk::raii::DescriptorSetLayout m_descriptorSetLayout {nullptr};
-    vk::raii::PipelineLayout      m_pipelineLayout {nullptr};
+    // Vertex shader invocations of the block draws, only created if the device supports the query
+    vk::raii::QueryPool                          m_statisticsQueryPool {nullptr};
+    std::array<bool, Renderer::maxFramesInFlight> m_statisticsWritten {};
 
-    vk::raii::DescriptorSet m_descriptorSet {nullptr};
+    BlockPipeline m_facePipeline;
+    BlockPipeline m_greedyPipeline;
 
-    vk::raii::Pipeline m_graphicsPipeline {nullptr};
+    OcclusionCullingPass m_occlusionCullingPass;
+    // Keeps the early draws for the sections which are only found visible after the depth pyramid was built
+    vk::raii::RenderPass m_lateRenderPass {nullptr};
 
     GPUProfilerContext m_renderingProfilerContext;
 
+    // Global buffers the descriptor sets of each frame in flight were written with, the draw call nodes recreate them when they run full
+    std::array<u32, Renderer::maxFramesInFlight> m_globalBufferVersions {};
+
+    // The view and light data sit at the same offsets every frame, so the recorded dynamic offsets stay valid
+    FrameAllocator::Reservation m_viewDataReservation;
+    FrameAllocator::Reservation m_lightConstantsReservation;
+    FrameAllocator::Reservation m_perLightReservation;
+    RecordingInputs             m_recordingInputs;
+    u32                         m_recordingVersion = 0u;
+
     struct PerLightBuffer
     {
         v3    lightColor;
@@ -4,14 +4,16 @@
 #include <Core/Profiler.hpp>
 #include <Core/StringInterner.hpp>
 
+#include <Logic/Camera.hpp>
+
 #include <Shader/ShaderManager.hpp>
 
 namespace dnm
 {
 namespace
 {
-    constexpr std::string_view vertexShader   = "Shaders/Gizmo.vert";
-    constexpr std::string_view fragmentShader = "Shaders/Gizmo.frag";
+    constexpr std::string_view vertexShader   = gizmoVertexShader.filePath;
+    constexpr std::string_view fragmentShader = gizmoFragmentShader.filePath;
 }   // namespace
 
 GizmoRenderingNode::GizmoRenderingNode(
@@ -22,14 +24,10 @@ GizmoRenderingNode::GizmoRenderingNode(
   StringInterner* interner,
   GizmoData*      gizmoData) :
     m_config {config}, m_renderer {renderer}, m_shaderManager {shaderManager}, m_blockWorld {blockWorld}, m_interner {interner}, m_gizmoData {gizmoData} {
-    const auto& physicalDevice = m_renderer->getPhysicalDevice();
-    const auto& device         = m_renderer->getDevice();
-
-    m_vertexHandle   = m_shaderManager->registerShaderFile(m_interner->addOrGetString(vertexShader), vk::ShaderStageFlagBits::eVertex);
-    m_fragmentHandle = m_shaderManager->registerShaderFile(m_interner->addOrGetString(fragmentShader), vk::ShaderStageFlagBits::eFragment);
+    const auto& device = m_renderer->getDevice();
 
-    m_vertexBuffer = BufferData(physicalDevice, device, GizmoData::reservedGizmoSpace * sizeof(VertexGizmo), vk::BufferUsageFlagBits::eVertexBuffer);
-    registerDebugMarker(device, m_vertexBuffer.buffer, "VertexBuffer Gizmos");
+    m_vertexHandle   = m_shaderManager->registerShaderFile(gizmoVertexShader);
+    m_fragmentHandle = m_shaderManager->registerShaderFile(gizmoFragmentShader);
 
     m_renderPass = makeRenderPass(device, renderer->getColorFormat(), vk::Format::eD32Sfloat, vk::AttachmentLoadOp::eLoad);
 
@@ -44,6 +42,31 @@ bool GizmoRenderingNode::shouldExecute() const {
     return m_gizmoData->m_occupiedVertexPlaces > 0;
 }
 
+std::vector<ResourceUsage> GizmoRenderingNode::getResourceUsages() const {
+    return {
+      ResourceUsage {Attachment::SwapChain,
+                     true, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                     vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite},
+      ResourceUsage {    Attachment::Depth,
+                     true, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                     vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite},
+      ResourceUsage {GlobalBuffers::ProjectionClip, false, vk::PipelineStageFlagBits::eVertexShader, vk::AccessFlagBits::eUniformRead},
+    };
+}
+
+bool GizmoRenderingNode::recordsInParallel() const {
+    return true;
+}
+
+void GizmoRenderingNode::prepareExecution(const ExecutionData&) {
+    ZoneScoped;
+    recompileShadersIfNecessary();
+
+    m_vertexCount  = m_gizmoData->m_occupiedVertexPlaces;
+    m_vertexOffset = m_renderer->getFrameAllocator().push(std::span<const VertexGizmo>(m_gizmoData->m_verticesGizmo.data(), m_vertexCount));
+    m_gizmoData->reset();
+}
+
 IRenderingNode::ExecutionResult GizmoRenderingNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
     ZoneScoped;
 
@@ -51,26 +74,25 @@ IRenderingNode::ExecutionResult GizmoRenderingNode::execute(const ExecutionData&
 
     auto& frameBuffer = m_renderer->getFrameBuffer(executionData.frameBufferIndex);
 
-    recompileShadersIfNecessary();
-
     const vk::RenderPassBeginInfo renderPassBeginInfo(*m_renderPass, *frameBuffer, vk::Rect2D(vk::Offset2D(0, 0), extent));
 
-    commandBuffer.reset();
     commandBuffer.begin(vk::CommandBufferBeginInfo());
 
     {
-        copyToDevice(m_vertexBuffer.deviceMemory, std::span<const VertexGizmo>(m_gizmoData->m_verticesGizmo.data(), m_gizmoData->m_occupiedVertexPlaces));
-        m_gizmoData->reset();
+        const std::array offsets {
+          DynamicOffset {viewBufferBindingPoint, executionData.viewDataOffset}
+        };
+        const auto dynamicOffsets = orderDynamicOffsets(m_slots, offsets);
 
         commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_graphicsPipeline);
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_pipelineLayout, 0, {*m_descriptorSet}, nullptr);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_pipelineLayout, 0, {*m_descriptorSet}, dynamicOffsets);
 
-        commandBuffer.bindVertexBuffers(0, {*m_vertexBuffer.buffer}, {0});
+        commandBuffer.bindVertexBuffers(0, {*m_renderer->getFrameAllocator().getBuffer().buffer}, {m_vertexOffset});
 
         commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 1.0f, 0.0f));
         commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
-        commandBuffer.draw(m_gizmoData->m_verticesGizmo.size(), 1u, 0u, 0u);
+        commandBuffer.draw(m_vertexCount, 1u, 0u, 0u);
 
         commandBuffer.endRenderPass();
     }
@@ -90,6 +112,8 @@ void GizmoRenderingNode::recreatePipeline() {
     vk::ShaderStageFlags     stageFlags;
     std::array               internedString {m_interner->addOrGetString(vertexShader), m_interner->addOrGetString(fragmentShader)};
     m_shaderManager->getBindingSlots(internedString, slots, stageFlags);
+    std::array dynamicSlots {viewBufferBindingPoint};
+    makeSlotsDynamic(slots, dynamicSlots);
     m_descriptorSetLayout = makeDescriptorSetLayout(device, slots, stageFlags);
     m_pipelineLayout      = vk::raii::PipelineLayout(device, {{}, *m_descriptorSetLayout});
 
@@ -115,18 +139,19 @@ void GizmoRenderingNode::recreatePipeline() {
       m_renderer->getRenderPass(),
       vk::PrimitiveTopology::eLineList);
     registerDebugMarker(device, m_graphicsPipeline, "Gizmo Graphics Pipeline");
+    m_renderer->markPipelineCacheDirty();
 
     const auto* projectionClipBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::ProjectionClip);
     assert(projectionClipBuffer);
-    const auto* viewBuffer = m_renderer->getGlobalBuffer(GlobalBuffers::CameraView);
-    assert(viewBuffer);
+    const auto& frameBuffer = m_renderer->getFrameAllocator().getBuffer().buffer;
 
     std::array update {
-      DescriptorSlotUpdate {projectionBufferBindingPoint, *projectionClipBuffer, VK_WHOLE_SIZE, nullptr},
-      DescriptorSlotUpdate {      viewBufferBindingPoint,           *viewBuffer, VK_WHOLE_SIZE, nullptr}
+      DescriptorSlotUpdate {projectionBufferBindingPoint, *projectionClipBuffer,            VK_WHOLE_SIZE, nullptr},
+      DescriptorSlotUpdate {      viewBufferBindingPoint,           frameBuffer, sizeof(Camera::ViewData), nullptr}
     };
 
     updateDescriptorSets(device, m_descriptorSet, update, slots);
+    m_slots = std::move(slots);
 }
 
 void GizmoRenderingNode::recompileShadersIfNecessary(bool force) {
@@ -137,7 +162,7 @@ void GizmoRenderingNode::recompileShadersIfNecessary(bool force) {
     auto processShader = [this, &device, &anyUpdated, &force](ShaderHandle handle, vk::raii::ShaderModule& shaderModule)
     {
         if (m_shaderManager->wasContentUpdated(handle) || force) {
-            auto recompiledVertexShader = m_shaderManager->getCompiledVersion(device, handle, {});
+            auto recompiledVertexShader = m_shaderManager->getCompiledVersion(device, handle);
             if (recompiledVertexShader) {
                 anyUpdated   = true;
                 shaderModule = std::move(recompiledVertexShader.value());
@@ -24,9 +24,12 @@ class GizmoRenderingNode : public IRenderingNode {
       StringInterner* interner,
       GizmoData*      gizmoData);
 
-    std::string_view getName() const override;
-    bool             shouldExecute() const override;
-    ExecutionResult  execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    std::string_view           getName() const override;
+    bool                       shouldExecute() const override;
+    std::vector<ResourceUsage> getResourceUsages() const override;
+    ExecutionResult            execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    bool                       recordsInParallel() const override;
+    void                       prepareExecution(const ExecutionData& executionData) override;
 
     private:
     void recreatePipeline();
@@ -48,9 +51,8 @@ class GizmoRenderingNode : public IRenderingNode {
     vk::raii::ShaderModule m_vertexShaderModule {nullptr};
     vk::raii::ShaderModule m_fragmentShaderModule {nullptr};
 
-    dnm::BufferData m_vertexBuffer {nullptr};
-
     vk::raii::RenderPass          m_renderPass {nullptr};
+    std::vector<BindingSlot>      m_slots;
     vk::raii::DescriptorSetLayout m_descriptorSetLayout {nullptr};
     vk::raii::PipelineLayout      m_pipelineLayout {nullptr};
 
@@ -59,5 +61,8 @@ class GizmoRenderingNode : public IRenderingNode {
     vk::raii::Pipeline m_graphicsPipeline {nullptr};
 
     GizmoData* m_gizmoData {nullptr};
+    // Vertices of this frame, pushed to the frame allocator before recording
+    u32        m_vertexCount  = 0u;
+    u32        m_vertexOffset = 0u;
 };
 }   // namespace dnm
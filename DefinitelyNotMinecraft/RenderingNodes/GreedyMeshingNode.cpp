@@ -0,0 +1,345 @@
+#include "RenderingNodes/GreedyMeshingNode.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include <Core/GLMInclude.hpp>
+#include <Core/Profiler.hpp>
+
+#include <Logic/Camera.hpp>
+
+namespace dnm
+{
+namespace
+{
+    // Sizes of the quad pool in quads, ranges are handed out by a buddy allocator
+    constexpr u64 initialQuadPoolCapacity = 1u << 18u;
+    constexpr u64 minQuadRangeSize        = 1u << 8u;
+
+    constexpr u32 verticesPerQuad = 6u;
+
+    // The render thread keeps half of the cores for itself and the world generation
+    u32 getMeshingWorkerCount() {
+        return std::max(1u, std::thread::hardware_concurrency() / 2u);
+    }
+}   // namespace
+
+GreedyMeshingNode::GreedyMeshingNode(Config* config, Renderer* renderer, BlockWorld* blockWorld, JobSystem* jobSystem) :
+    m_config {config}, m_renderer {renderer}, m_blockWorld {blockWorld}, m_mesher {jobSystem, getMeshingWorkerCount()} {
+    m_chunkOriginBuffer = m_renderer->createBuffer(
+      maxChunkSlots * sizeof(glm::ivec2),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Greedy Chunk Origins",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_chunkOriginRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::GreedyChunkOrigin, m_chunkOriginBuffer);
+
+    m_drawCommandBuffer = m_renderer->createBuffer(
+      maxChunkSlots * sizeof(vk::DrawIndirectCommand),
+      vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Greedy Draw Commands",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_drawCommandRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::GreedyDrawCommand, m_drawCommandBuffer);
+
+    m_drawCountBuffer = m_renderer->createBuffer(
+      sizeof(u32), vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, "Greedy Draw Count", vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_drawCountRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::GreedyDrawCount, m_drawCountBuffer);
+
+    m_chunkOrigins.resize(maxChunkSlots);
+    m_chunkOriginsDirty = true;
+    m_residentMeshes.resize(maxChunkSlots);
+    releaseAll();
+}
+
+std::string_view GreedyMeshingNode::getName() const {
+    return "GreedyMeshingNode";
+}
+
+bool GreedyMeshingNode::shouldExecute() const {
+    // Runs once more after being disabled to release its meshes
+    return m_config->greedyMeshing || m_enabledLastFrame;
+}
+
+std::vector<ResourceUsage> GreedyMeshingNode::getResourceUsages() const {
+    // Releasing the meshes writes nothing the GPU reads, declaring no writes keeps the node from being culled
+    if (!m_config->greedyMeshing) {
+        return {};
+    }
+
+    constexpr vk::PipelineStageFlags transfer = vk::PipelineStageFlagBits::eTransfer;
+    constexpr vk::AccessFlags        write    = vk::AccessFlagBits::eTransferWrite;
+    return {
+      ResourceUsage {GlobalBuffers::GreedyChunkOrigin, true, transfer, write},
+      ResourceUsage {       GlobalBuffers::GreedyQuad, true, transfer, write},
+      ResourceUsage {GlobalBuffers::GreedyDrawCommand, true, transfer, write},
+      ResourceUsage {  GlobalBuffers::GreedyDrawCount, true, transfer, write},
+    };
+}
+
+void GreedyMeshingNode::releaseAll() {
+    std::ranges::fill(m_residentMeshes, ResidentMesh {});
+    m_chunkSlots.clear();
+    m_requestedVersions.clear();
+    m_freeSlots.resize(maxChunkSlots);
+    for (u32 i = 0u; i < maxChunkSlots; ++i) {
+        m_freeSlots [i] = maxChunkSlots - 1u - i;
+    }
+    rebuildQuadPool(initialQuadPoolCapacity);
+    writeDrawCommands();
+}
+
+u32 GreedyMeshingNode::acquireSlot(glm::ivec2 chunk) {
+    assert(!m_freeSlots.empty());
+    const u32 slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    m_chunkSlots.emplace(chunk, slot);
+    m_residentMeshes [slot] = ResidentMesh {.position = chunk, .inUse = true};
+    m_chunkOrigins [slot]   = chunk * static_cast<i32>(BlockWorld::chunkLocalSize);
+    m_chunkOriginsDirty     = true;
+    return slot;
+}
+
+void GreedyMeshingNode::releaseSlot(u32 slot) {
+    auto& resident = m_residentMeshes [slot];
+    if (!resident.quads.empty()) {
+        m_quadPool->free(resident.quadOffset, resident.quads.size());
+    }
+    resident = ResidentMesh {};
+    m_freeSlots.emplace_back(slot);
+}
+
+bool GreedyMeshingNode::allocateQuadRange(ResidentMesh& resident) {
+    if (resident.quads.empty()) {
+        return true;
+    }
+
+    const auto offset = m_quadPool->allocate(resident.quads.size());
+    if (!offset) {
+        return false;
+    }
+    resident.quadOffset = static_cast<u32>(*offset);
+    return true;
+}
+
+void GreedyMeshingNode::rebuildQuadPool(u64 capacity) {
+    ZoneScoped;
+    // Placing the largest ranges first keeps the pool from fragmenting
+    std::vector<u32> slots;
+    for (u32 slot = 0u; slot < m_residentMeshes.size(); ++slot) {
+        if (m_residentMeshes [slot].inUse) {
+            slots.emplace_back(slot);
+        }
+    }
+    std::ranges::sort(slots, std::greater {}, [this](u32 slot) { return m_residentMeshes [slot].quads.size(); });
+
+    while (true) {
+        m_quadPool.emplace(capacity, minQuadRangeSize);
+        const bool fits = std::ranges::all_of(slots, [this](u32 slot) { return allocateQuadRange(m_residentMeshes [slot]); });
+        if (fits) {
+            break;
+        }
+        capacity *= 2u;
+    }
+
+    // The old registration has to go first, destroying it afterwards would unregister the new buffer
+    m_quadRegistration.reset();
+    if (*m_quadBuffer.buffer) {
+        m_retiredQuadBuffers [m_renderer->getFrameIndex()].push_back(RetiredQuadBuffer {std::move(m_quadBuffer), m_quadUpload});
+    }
+    m_quadBuffer = m_renderer->createBuffer(
+      capacity * sizeof(GreedyQuad),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Greedy Quads",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_quadRegistration = m_renderer->registerRAIIBuffer(GlobalBuffers::GreedyQuad, m_quadBuffer);
+
+    // The quads are kept on the CPU, so nothing has to be meshed again
+    for (const u32 slot : slots) {
+        uploadMesh(m_residentMeshes [slot]);
+    }
+}
+
+void GreedyMeshingNode::uploadMesh(const ResidentMesh& resident) {
+    if (resident.quads.empty()) {
+        return;
+    }
+    m_quadUpload = m_renderer->getUploader().upload(m_quadBuffer, std::span<const GreedyQuad>(resident.quads), resident.quadOffset * sizeof(GreedyQuad));
+}
+
+bool GreedyMeshingNode::requestMeshes(v3 cameraPosition) {
+    ZoneScoped;
+    const glm::ivec2 cameraChunk {cameraPosition.x / BlockWorld::chunkLocalSize, cameraPosition.z / BlockWorld::chunkLocalSize};
+
+    m_config->loadCountChunks = std::min(m_config->loadCountChunks, maxLoadCountChunks);
+    m_windowMin = glm::ivec2 {cameraChunk.x - m_config->loadCountChunks, cameraChunk.y - m_config->loadCountChunks};
+    m_windowMax = glm::ivec2 {cameraChunk.x + m_config->loadCountChunks, cameraChunk.y + m_config->loadCountChunks};
+
+    const auto outsideWindow = [this](glm::ivec2 chunk)
+    { return chunk.x < m_windowMin.x || chunk.x > m_windowMax.x || chunk.y < m_windowMin.y || chunk.y > m_windowMax.y; };
+
+    // Chunks which left the window give their slot and quad range back
+    bool anyReleased = false;
+    for (auto it = m_chunkSlots.begin(); it != m_chunkSlots.end();) {
+        if (outsideWindow(it->first)) {
+            releaseSlot(it->second);
+            it          = m_chunkSlots.erase(it);
+            anyReleased = true;
+        }
+        else {
+            ++it;
+        }
+    }
+    std::erase_if(m_requestedVersions, [&outsideWindow](const auto& entry) { return outsideWindow(entry.first); });
+
+    for (i32 z = m_windowMin.y; z <= m_windowMax.y; ++z) {
+        for (i32 x = m_windowMin.x; x <= m_windowMax.x; ++x) {
+            const glm::ivec2 chunk {x, z};
+            // Has to be queried before the request processes the pending visibility update
+            const bool dirty     = m_blockWorld->isRenderingDirty(chunk);
+            const bool requested = m_requestedVersions.contains(chunk);
+            if (requested && !dirty) {
+                continue;
+            }
+
+            if (m_blockWorld->requestChunk(chunk) != BlockWorld::ChunkState::FinishedGeneration) {
+                continue;
+            }
+
+            const u32 version           = ++m_nextVersion;
+            m_requestedVersions [chunk] = version;
+            m_mesher.request(chunk, version, m_blockWorld->getChunkData(chunk));
+        }
+    }
+    return anyReleased;
+}
+
+bool GreedyMeshingNode::placeFinishedMeshes() {
+    ZoneScoped;
+    std::vector<GreedyMesher::Mesh> meshes;
+    m_mesher.collectFinished(meshes);
+
+    bool poolExhausted = false;
+    bool anyPlaced     = false;
+    for (auto& mesh : meshes) {
+        const auto versionIt = m_requestedVersions.find(mesh.chunk);
+        if (versionIt == m_requestedVersions.end() || versionIt->second != mesh.version) {
+            continue;
+        }
+
+        const auto slotIt = m_chunkSlots.find(mesh.chunk);
+        const u32  slot   = slotIt != m_chunkSlots.end() ? slotIt->second : acquireSlot(mesh.chunk);
+
+        auto& resident = m_residentMeshes [slot];
+        if (!resident.quads.empty()) {
+            m_quadPool->free(resident.quadOffset, resident.quads.size());
+        }
+
+        // The mesher doesn't know where the chunk is placed, its slot completes the packed faces
+        resident.quads = std::move(mesh.quads);
+        for (auto& quad : resident.quads) {
+            quad.face |= slot << chunkSlotShift;
+        }
+        resident.faceCount = mesh.faceCount;
+        anyPlaced          = true;
+
+        if (!allocateQuadRange(resident)) {
+            // The mesh has no valid range, the rebuild below places it
+            resident.quadOffset = 0u;
+            poolExhausted       = true;
+            continue;
+        }
+        uploadMesh(resident);
+    }
+
+    const u64 poolCapacity = m_quadPool->getCapacity();
+    if (poolExhausted) {
+        rebuildQuadPool(poolCapacity * 2u);
+    }
+    else if (anyPlaced && poolCapacity > initialQuadPoolCapacity && m_quadPool->getUsedSize() < poolCapacity / 4u) {
+        rebuildQuadPool(poolCapacity / 2u);
+    }
+
+    return anyPlaced;
+}
+
+void GreedyMeshingNode::releaseRetiredQuadBuffers(u32 frameIndex) {
+    // The fence of this frame in flight was waited on, so only copies which are still queued can reach the buffers
+    for (const auto& retired : m_retiredQuadBuffers [frameIndex]) {
+        if (retired.lastUpload.value > 0u) {
+            m_renderer->getUploader().wait(retired.lastUpload);
+        }
+    }
+    m_retiredQuadBuffers [frameIndex].clear();
+}
+
+void GreedyMeshingNode::writeDrawCommands() {
+    ZoneScoped;
+    m_drawCommands.clear();
+    u64 quadCount = 0u;
+    u64 faceCount = 0u;
+    for (const auto& resident : m_residentMeshes) {
+        if (!resident.inUse || resident.quads.empty()) {
+            continue;
+        }
+
+        const u32 residentQuadCount = static_cast<u32>(resident.quads.size());
+        m_drawCommands.emplace_back(residentQuadCount * verticesPerQuad, 1u, resident.quadOffset * verticesPerQuad, 0u);
+        quadCount += residentQuadCount;
+        faceCount += resident.faceCount;
+    }
+
+    m_drawCommandsDirty = true;
+
+    TracyPlot("Greedy Quads", static_cast<i64>(quadCount));
+    TracyPlot("Greedy Triangles", static_cast<i64>(quadCount * 2u));
+    TracyPlot("Per Face Triangles", static_cast<i64>(faceCount * 2u));
+}
+
+void GreedyMeshingNode::recordTableCopies(const vk::raii::CommandBuffer& commandBuffer) {
+    auto&       frameAllocator = m_renderer->getFrameAllocator();
+    const auto& source         = *frameAllocator.getBuffer().buffer;
+    if (m_chunkOriginsDirty) {
+        const u32 originOffset = frameAllocator.push(std::span<const glm::ivec2>(m_chunkOrigins));
+        commandBuffer.copyBuffer(source, *m_chunkOriginBuffer.buffer, vk::BufferCopy(originOffset, 0u, m_chunkOrigins.size() * sizeof(glm::ivec2)));
+        m_chunkOriginsDirty = false;
+    }
+    if (m_drawCommandsDirty) {
+        if (!m_drawCommands.empty()) {
+            const u32 commandOffset = frameAllocator.push(std::span<const vk::DrawIndirectCommand>(m_drawCommands));
+            commandBuffer.copyBuffer(
+              source, *m_drawCommandBuffer.buffer, vk::BufferCopy(commandOffset, 0u, m_drawCommands.size() * sizeof(vk::DrawIndirectCommand)));
+        }
+        const u32 countOffset = frameAllocator.push(static_cast<u32>(m_drawCommands.size()));
+        commandBuffer.copyBuffer(source, *m_drawCountBuffer.buffer, vk::BufferCopy(countOffset, 0u, sizeof(u32)));
+        m_drawCommandsDirty = false;
+    }
+}
+
+IRenderingNode::ExecutionResult GreedyMeshingNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
+    ZoneScoped;
+    releaseRetiredQuadBuffers(m_renderer->getFrameIndex());
+
+    if (!m_config->greedyMeshing) {
+        releaseAll();
+        m_enabledLastFrame = false;
+    }
+    else {
+        m_enabledLastFrame = true;
+
+        const bool anyReleased = requestMeshes(executionData.camera->getPosition());
+        const bool anyPlaced   = placeFinishedMeshes();
+        if (anyReleased || anyPlaced) {
+            writeDrawCommands();
+        }
+        TracyPlot("Greedy Meshing Jobs", static_cast<i64>(m_mesher.getPendingCount()));
+    }
+
+    // The meshing happens on the CPU and the quads go through the uploader, the forward pass waits on the copies
+    commandBuffer.begin(vk::CommandBufferBeginInfo());
+    recordTableCopies(commandBuffer);
+    commandBuffer.end();
+
+    return ExecutionResult {{}, m_renderer->getGraphicsQueue(), m_quadUpload};
+}
+}   // namespace dnm
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+
+#include <Core/BuddyAllocator.hpp>
+#include <Core/Config.hpp>
+#include <Core/JobSystem.hpp>
+
+#include <Logic/BlockWorld.hpp>
+#include <Logic/GreedyMesher.hpp>
+
+#include <Rendering/Renderer.hpp>
+#include <RenderingNodes/IRenderingNode.hpp>
+
+namespace dnm
+{
+// Alternative to the BlockDrawCallNode: chunks are greedy meshed on worker threads and every chunk with quads
+// gets an indirect draw command, which the ForwardRenderingNode draws with a single multi draw indirect.
+class GreedyMeshingNode : public IRenderingNode {
+    public:
+    explicit GreedyMeshingNode(Config* config, Renderer* renderer, BlockWorld* blockWorld, JobSystem* jobSystem);
+
+    std::string_view           getName() const override;
+    bool                       shouldExecute() const override;
+    std::vector<ResourceUsage> getResourceUsages() const override;
+    ExecutionResult            execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+
+    private:
+    struct ResidentMesh
+    {
+        glm::ivec2 position {};
+        // Range of the quad pool in quads
+        u32                     quadOffset = 0u;
+        u32                     faceCount  = 0u;
+        std::vector<GreedyQuad> quads;
+        bool                    inUse = false;
+    };
+
+    // Drops every mesh, so the chunks are meshed again once the node is enabled
+    void releaseAll();
+    u32  acquireSlot(glm::ivec2 chunk);
+    void releaseSlot(u32 slot);
+    bool allocateQuadRange(ResidentMesh& resident);
+    // Places every resident mesh in a new pool of at least this many quads and uploads them again
+    void rebuildQuadPool(u64 capacity);
+    // Destroys the quad buffers which were replaced the last time this frame in flight was recorded
+    void releaseRetiredQuadBuffers(u32 frameIndex);
+    void uploadMesh(const ResidentMesh& resident);
+
+    // Both return true if they changed any draw command
+    bool requestMeshes(v3 cameraPosition);
+    bool placeFinishedMeshes();
+    void writeDrawCommands();
+    // Copies the tables which changed from the frame allocator, frames in flight may still read the old ones
+    void recordTableCopies(const vk::raii::CommandBuffer& commandBuffer);
+
+    Config*     m_config;
+    Renderer*   m_renderer;
+    BlockWorld* m_blockWorld;
+
+    GreedyMesher m_mesher;
+
+    dnm::BufferData m_quadBuffer {nullptr};
+    dnm::BufferData m_chunkOriginBuffer {nullptr};
+    dnm::BufferData m_drawCommandBuffer {nullptr};
+    dnm::BufferData m_drawCountBuffer {nullptr};
+
+    std::unique_ptr<BufferRegistration> m_quadRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_chunkOriginRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_drawCommandRegistration {nullptr};
+    std::unique_ptr<BufferRegistration> m_drawCountRegistration {nullptr};
+
+    std::vector<glm::ivec2>              m_chunkOrigins;
+    std::vector<vk::DrawIndirectCommand> m_drawCommands;
+    bool                                 m_chunkOriginsDirty = false;
+    bool                                 m_drawCommandsDirty = false;
+
+    std::vector<ResidentMesh>           m_residentMeshes;
+    std::unordered_map<glm::ivec2, u32> m_chunkSlots;
+    std::vector<u32>                    m_freeSlots;
+    std::optional<BuddyAllocator>       m_quadPool;
+
+    // Latest version requested per chunk of the window, older meshes which finish afterwards are dropped
+    std::unordered_map<glm::ivec2, u32> m_requestedVersions;
+    u32                                 m_nextVersion = 0u;
+
+    glm::ivec2 m_windowMin {};
+    glm::ivec2 m_windowMax {};
+
+    UploadToken m_quadUpload {};
+    bool        m_enabledLastFrame = false;
+
+    // Replaced quad buffers stay alive until the frames in flight which may still read them have finished
+    struct RetiredQuadBuffer
+    {
+        dnm::BufferData buffer {nullptr};
+        // Last copy into the buffer
+        UploadToken lastUpload {};
+    };
+
+    std::array<std::vector<RetiredQuadBuffer>, Renderer::maxFramesInFlight> m_retiredQuadBuffers;
+};
+}   // namespace dnm
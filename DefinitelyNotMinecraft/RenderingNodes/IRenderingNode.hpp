@@ -5,31 +5,84 @@
 
 #include <Core/ShortTypes.hpp>
 
+#include <Rendering/GlobalBuffers.hpp>
+#include <Rendering/StagingUploader.hpp>
+
+#include <optional>
 #include <string_view>
+#include <variant>
+#include <vector>
 
 namespace dnm
 {
 class Camera;
 
+// Attachments of the renderer, tracked by the render graph next to the global buffers
+enum class Attachment : u8
+{
+    SwapChain,
+    Depth
+};
+
+struct ResourceUsage
+{
+    std::variant<GlobalBuffers, Attachment> resource;
+    bool                                    write = false;
+    // Stages and accesses of the node's command buffer which touch the resource
+    vk::PipelineStageFlags                  stages;
+    vk::AccessFlags                         access;
+};
+
 class IRenderingNode {
     public:
     virtual ~IRenderingNode() = default;
 
     virtual std::string_view getName() const       = 0;
     virtual bool             shouldExecute() const = 0;
+    // Queried every frame before execute, so it may follow the config. Nodes whose writes are never read are culled,
+    // unless they write an attachment or declare no writes at all
+    virtual std::vector<ResourceUsage> getResourceUsages() const = 0;
 
     struct ExecutionData
     {
         u32     frameBufferIndex;
         Camera* camera;
+        // Offset of the camera's view data in the frame allocator
+        u32     viewDataOffset;
+        // Increases by one every executed frame, a gap means the node was culled in between
+        u64     frameNumber;
     };
 
     struct ExecutionResult
     {
         vk::PipelineStageFlags flags;
         const vk::raii::Queue& queue;
+        // Uploads the submitted work consumes, the submission waits on them on the device
+        UploadToken            uploadDependency {};
     };
 
     virtual ExecutionResult execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) = 0;
+
+    // Nodes returning true have to return Renderer::getComputeQueue from execute, otherwise the graphics queue.
+    // Their command buffer is allocated for the compute family, so only compute and transfer commands are allowed.
+    virtual bool runsOnComputeQueue() const {
+        return false;
+    }
+
+    // Nodes returning true are recorded on a worker thread next to the other nodes. Their execute may only touch the
+    // node itself and the device, everything else like shader reloads or frame allocations belongs into prepareExecution.
+    virtual bool recordsInParallel() const {
+        return false;
+    }
+
+    // Called on the main thread in registration order, before any node of the frame is recorded
+    virtual void prepareExecution(const ExecutionData&) {}
+
+    // Nodes returning a version are recorded once per frame in flight and swap chain image, the graph submits the same
+    // command buffer again until the version changes. Their execute may not depend on anything else, data which changes
+    // every frame has to be written to reserved ranges of the frame allocator in prepareExecution.
+    virtual std::optional<u64> getStaticVersion() const {
+        return std::nullopt;
+    }
 };
 }   // namespace dnm
\ No newline at end of file
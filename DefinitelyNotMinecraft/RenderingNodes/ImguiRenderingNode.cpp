@@ -1,5 +1,7 @@
 #include "RenderingNodes/ImguiRenderingNode.hpp"
 
+#include <algorithm>
+
 #include "imgui.h"
 #include "imgui_impl_vulkan.h"
 
@@ -23,7 +25,8 @@ ImguiRenderingNode::ImguiRenderingNode(Config* config, Renderer* renderer) : m_c
     init_info.DescriptorPool            = *m_renderer->getDescriptorPool();
     init_info.Subpass                   = 0;
     init_info.MinImageCount             = 2;
-    init_info.ImageCount                = 2;
+    // Imgui cycles through one set of vertex buffers per image count, each frame in flight needs its own
+    init_info.ImageCount                = std::max(2u, Renderer::maxFramesInFlight);
     init_info.MSAASamples               = VK_SAMPLE_COUNT_1_BIT;
     init_info.Allocator                 = nullptr;
     ImGui_ImplVulkan_Init(&init_info, *m_renderPass);
@@ -49,6 +52,21 @@ bool ImguiRenderingNode::shouldExecute() const {
     return !is_minimized;
 }
 
+std::vector<ResourceUsage> ImguiRenderingNode::getResourceUsages() const {
+    return {
+      ResourceUsage {Attachment::SwapChain,
+                     true, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                     vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite},
+      ResourceUsage {    Attachment::Depth,
+                     true, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                     vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite},
+    };
+}
+
+bool ImguiRenderingNode::recordsInParallel() const {
+    return true;
+}
+
 IRenderingNode::ExecutionResult ImguiRenderingNode::execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) {
     ZoneScoped;
 
@@ -62,8 +80,6 @@ IRenderingNode::ExecutionResult ImguiRenderingNode::execute(const ExecutionData&
 
     const vk::RenderPassBeginInfo renderPassBeginInfo(*m_renderPass, *frameBuffer, vk::Rect2D(vk::Offset2D(0, 0), extent), clearValues);
 
-    commandBuffer.reset();
-
     commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
 
     commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
@@ -93,12 +109,11 @@ void ImguiRenderingNode::uploadFontTexture() {
 
     VkResult err;
 
-    auto& physicalDevice = m_renderer->getPhysicalDevice();
-    auto& device         = m_renderer->getDevice();
+    auto& allocator = m_renderer->getMemoryAllocator();
+    auto& device    = m_renderer->getDevice();
 
     m_fontTexture = TextureData(
-      physicalDevice,
-      device,
+      allocator,
       vk::Extent2D(width, height),
       vk::Format::eB8G8R8A8Unorm,
       {},
@@ -16,9 +16,11 @@ class ImguiRenderingNode : public IRenderingNode {
 
     vk::raii::Semaphore& getRenderingFinishedSemaphore();
 
-    std::string_view getName() const override;
-    bool             shouldExecute() const override;
-    ExecutionResult  execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    std::string_view           getName() const override;
+    bool                       shouldExecute() const override;
+    std::vector<ResourceUsage> getResourceUsages() const override;
+    ExecutionResult            execute(const ExecutionData& executionData, vk::raii::CommandBuffer& commandBuffer) override;
+    bool                       recordsInParallel() const override;
 
     private:
     void recreatePipeline();
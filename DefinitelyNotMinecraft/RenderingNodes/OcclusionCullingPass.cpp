@@ -0,0 +1,285 @@
+#include "RenderingNodes/OcclusionCullingPass.hpp"
+
+#include <Core/GLMInclude.hpp>
+#include <Core/Profiler.hpp>
+#include <Core/StringInterner.hpp>
+
+#include <Logic/Camera.hpp>
+
+#include <Shader/ShaderManager.hpp>
+
+namespace dnm
+{
+namespace
+{
+    constexpr std::string_view reductionShader = depthPyramidShader.filePath;
+    constexpr std::string_view cullingShader   = occlusionCullingShader.filePath;
+
+    constexpr std::string_view depthCopyBindingPoint        = "depthCopyBuffer";
+    constexpr std::string_view pyramidReductionBindingPoint = "pyramidReduction";
+    constexpr std::string_view occlusionCullingBindingPoint = "occlusionCullingData";
+    constexpr std::string_view lateDrawCallBindingPoint     = "lateDrawCallBuffer";
+
+    // Layout of the pyramidReduction uniform in Shaders/DepthPyramid.comp
+    struct PyramidReduction
+    {
+        glm::uvec2 sourceSize;
+        glm::uvec2 targetSize;
+        u32        sourceOffset;
+        u32        targetOffset;
+        u32        readsDepthCopy;
+    };
+
+    constexpr u32 reductionGroupSize = 8u;
+}   // namespace
+
+OcclusionCullingPass::OcclusionCullingPass(Config* config, Renderer* renderer, ShaderManager* shaderManager, StringInterner* interner) :
+    m_config {config}, m_renderer {renderer}, m_shaderManager {shaderManager}, m_interner {interner} {
+    m_reductionHandle = m_shaderManager->registerShaderFile(depthPyramidShader);
+    m_cullingHandle   = m_shaderManager->registerShaderFile(occlusionCullingShader);
+
+    m_lateDrawCommandBuffer = m_renderer->createBuffer(
+      maxSectionDrawCount * sizeof(vk::DrawIndexedIndirectCommand),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+      "Late Draw Commands",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    m_counterReadback = m_renderer->createBuffer(
+      sizeof(OcclusionCounters) * Renderer::maxFramesInFlight, vk::BufferUsageFlagBits::eTransferDst, "Occlusion Count Readback");
+    memset(m_counterReadback.getMapped(), 0, m_counterReadback.getSize());
+
+    auto& frameAllocator     = m_renderer->getFrameAllocator();
+    m_cullingDataReservation = frameAllocator.reserve(sizeof(m4));
+    for (auto& reservation : m_reductionReservations) {
+        reservation = frameAllocator.reserve(sizeof(PyramidReduction));
+    }
+
+    recreateDepthCopy();
+
+    recompileShadersIfNecessary(true);
+}
+
+const vk::raii::Buffer& OcclusionCullingPass::getLateDrawCommands() const {
+    return m_lateDrawCommandBuffer.buffer;
+}
+
+u32 OcclusionCullingPass::getRecordingVersion() const {
+    return m_recordingVersion;
+}
+
+void OcclusionCullingPass::recreatePipeline() {
+    m_renderer->waitIdle();
+
+    const auto& device = m_renderer->getDevice();
+
+    m_descriptorSets.clear();
+
+    // Both passes read the depth pyramid, so they share one layout and each frame in flight one descriptor set
+    std::vector<BindingSlot> slots;
+    vk::ShaderStageFlags     stageFlags;
+    std::array               internedString {m_interner->addOrGetString(reductionShader), m_interner->addOrGetString(cullingShader)};
+    m_shaderManager->getBindingSlots(internedString, slots, stageFlags);
+    std::array dynamicSlots {pyramidReductionBindingPoint, occlusionCullingBindingPoint};
+    makeSlotsDynamic(slots, dynamicSlots);
+    m_descriptorSetLayout = makeDescriptorSetLayout(device, slots, stageFlags);
+    m_pipelineLayout      = vk::raii::PipelineLayout(device, {{}, *m_descriptorSetLayout});
+
+    const std::vector<vk::DescriptorSetLayout> layouts(Renderer::maxFramesInFlight, *m_descriptorSetLayout);
+    m_descriptorSets = vk::raii::DescriptorSets(device, {*m_renderer->getDescriptorPool(), layouts});
+
+    m_reductionPipeline = makeComputePipeline(device, m_renderer->getPipelineCache(), m_reductionModule, nullptr, m_pipelineLayout);
+    registerDebugMarker(device, m_reductionPipeline, "Depth Pyramid Compute Pipeline");
+
+    m_cullingPipeline = makeComputePipeline(device, m_renderer->getPipelineCache(), m_cullingModule, nullptr, m_pipelineLayout);
+    registerDebugMarker(device, m_cullingPipeline, "Occlusion Culling Compute Pipeline");
+    m_renderer->markPipelineCacheDirty();
+
+    const auto& frameBuffer = m_renderer->getFrameAllocator().getBuffer().buffer;
+    for (u32 frameIndex = 0u; frameIndex < Renderer::maxFramesInFlight; ++frameIndex) {
+        const auto* depthPyramid   = m_renderer->getGlobalBuffer(GlobalBuffers::DepthPyramid, frameIndex);
+        const auto* candidates     = m_renderer->getGlobalBuffer(GlobalBuffers::OcclusionCandidate, frameIndex);
+        const auto* candidateDraws = m_renderer->getGlobalBuffer(GlobalBuffers::OcclusionCandidateDraw, frameIndex);
+        const auto* occlusionCount = m_renderer->getGlobalBuffer(GlobalBuffers::OcclusionCount, frameIndex);
+        assert(depthPyramid && candidates && candidateDraws && occlusionCount);
+
+        std::array update {
+          DescriptorSlotUpdate {    depthPyramidBindingPoint,                   *depthPyramid,            VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {       depthCopyBindingPoint,        m_depthCopyBuffer.buffer,            VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {pyramidReductionBindingPoint,                     frameBuffer, sizeof(PyramidReduction), nullptr},
+          DescriptorSlotUpdate {       candidateBindingPoint,                     *candidates,            VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {   candidateDrawBindingPoint,                 *candidateDraws,            VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {  occlusionCountBindingPoint,                 *occlusionCount,            VK_WHOLE_SIZE, nullptr},
+          DescriptorSlotUpdate {occlusionCullingBindingPoint,                     frameBuffer,               sizeof(m4), nullptr},
+          DescriptorSlotUpdate {    lateDrawCallBindingPoint, m_lateDrawCommandBuffer.buffer,            VK_WHOLE_SIZE, nullptr}
+        };
+        updateDescriptorSets(device, m_descriptorSets [frameIndex], update, slots);
+    }
+
+    m_slots               = std::move(slots);
+    m_globalBufferVersion = m_renderer->getGlobalBufferVersion();
+    ++m_recordingVersion;
+}
+
+void OcclusionCullingPass::recompileShadersIfNecessary(bool force) {
+    const auto& device = m_renderer->getDevice();
+
+    const bool anyUpdated = m_shaderManager->wasContentUpdated(m_reductionHandle) || m_shaderManager->wasContentUpdated(m_cullingHandle);
+    if (anyUpdated || force) {
+        auto recompiledReductionShader = m_shaderManager->getCompiledVersion(device, m_reductionHandle);
+        auto recompiledCullingShader   = m_shaderManager->getCompiledVersion(device, m_cullingHandle);
+        if (recompiledReductionShader && recompiledCullingShader) {
+            m_reductionModule = std::move(recompiledReductionShader.value());
+            m_cullingModule   = std::move(recompiledCullingShader.value());
+
+            recreatePipeline();
+            std::cout << "Successfully recompiled shaders and recreated the pipeline "
+                         "for the occlusion culling module.\n";
+        }
+    }
+}
+
+void OcclusionCullingPass::recreateDepthCopy() {
+    m_depthCopyExtent = m_renderer->getExtent();
+    m_depthCopyBuffer = m_renderer->createBuffer(
+      static_cast<vk::DeviceSize>(m_depthCopyExtent.width) * m_depthCopyExtent.height * sizeof(float),
+      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+      "Depth Copy",
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+}
+
+void OcclusionCullingPass::plotOcclusionCounters() const {
+    // The fence of the frame which last wrote this copy was already waited on
+    OcclusionCounters counters;
+    memcpy(&counters, m_counterReadback.getMapped() + m_renderer->getFrameIndex() * sizeof(OcclusionCounters), sizeof(counters));
+
+    const u32 occludedSections = counters.candidateCount - counters.lateVisibleSections;
+    TracyPlot("Occlusion Tested Sections", static_cast<i64>(counters.testedSections));
+    TracyPlot("Occluded Sections", static_cast<i64>(occludedSections));
+    TracyPlot("Occluded Sections %", counters.testedSections > 0u ? 100.0 * occludedSections / counters.testedSections : 0.0);
+
+    // Candidates which an earlier frame's depth hid but this frame's doesn't, they are drawn late instead of popping in
+    TracyPlot("Disoccluded Sections", static_cast<i64>(counters.lateVisibleSections));
+    TracyPlot("False Occlusion %", counters.candidateCount > 0u ? 100.0 * counters.lateVisibleSections / counters.candidateCount : 0.0);
+    TracyPlot("Late Visible Faces", static_cast<i64>(counters.lateVisibleFaces));
+}
+
+void OcclusionCullingPass::prepare(const Camera* camera, bool cullCandidates) {
+    ZoneScoped;
+
+    recompileShadersIfNecessary();
+
+    // The renderer recreates the depth pyramid together with the swap chain, which also changes the extent
+    const auto extent = m_renderer->getExtent();
+    if (extent != m_depthCopyExtent) {
+        recreateDepthCopy();
+        recreatePipeline();
+    }
+    else if (m_globalBufferVersion != m_renderer->getGlobalBufferVersion()) {
+        recreatePipeline();
+    }
+    if (cullCandidates) {
+        plotOcclusionCounters();
+    }
+
+    const u32 frameIndex     = m_renderer->getFrameIndex();
+    auto&     frameAllocator = m_renderer->getFrameAllocator();
+    frameAllocator.write(m_cullingDataReservation, frameIndex, m_renderer->getProjectionMatrix() * camera->getViewMatrix());
+
+    const auto& header     = m_renderer->getDepthPyramidHeader();
+    glm::uvec2  sourceSize = header.depthSize;
+    for (u32 level = 0u; level < header.levelCount; ++level) {
+        const glm::uvec2       targetSize = (sourceSize + 1u) / 2u;
+        const PyramidReduction reduction {
+          sourceSize, targetSize, level > 0u ? header.levelOffsets [level - 1u] : 0u, header.levelOffsets [level], static_cast<u32>(level == 0u)};
+        frameAllocator.write(m_reductionReservations [level], frameIndex, reduction);
+        sourceSize = targetSize;
+    }
+}
+
+void OcclusionCullingPass::record(const vk::raii::CommandBuffer& commandBuffer, bool cullCandidates) const {
+    ZoneScoped;
+
+    const auto& header         = m_renderer->getDepthPyramidHeader();
+    const auto* depthPyramid   = m_renderer->getGlobalBuffer(GlobalBuffers::DepthPyramid);
+    const auto& frameAllocator = m_renderer->getFrameAllocator();
+    const u32   frameIndex     = m_renderer->getFrameIndex();
+
+    const u32  cullingDataOffset = frameAllocator.getReserved(m_cullingDataReservation, frameIndex).offset;
+    const auto extent            = m_renderer->getExtent();
+
+    const auto&                     depthImage = m_renderer->getDepthBuffer().image;
+    const vk::ImageSubresourceRange depthRange(vk::ImageAspectFlagBits::eDepth, 0u, 1u, 0u, 1u);
+
+    // The early draws have to be done writing the depth before it is copied
+    const vk::ImageMemoryBarrier toTransfer(
+      vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      vk::AccessFlagBits::eTransferRead,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+      vk::ImageLayout::eTransferSrcOptimal,
+      VK_QUEUE_FAMILY_IGNORED,
+      VK_QUEUE_FAMILY_IGNORED,
+      *depthImage,
+      depthRange);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+    const vk::BufferImageCopy depthCopy(
+      0u, 0u, 0u, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eDepth, 0u, 0u, 1u), vk::Offset3D(0, 0, 0), vk::Extent3D(extent, 1u));
+    commandBuffer.copyImageToBuffer(*depthImage, vk::ImageLayout::eTransferSrcOptimal, *m_depthCopyBuffer.buffer, depthCopy);
+    commandBuffer.updateBuffer<DepthPyramidHeader>(**depthPyramid, 0u, header);
+
+    const vk::ImageMemoryBarrier toAttachment(
+      vk::AccessFlagBits::eTransferRead,
+      vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      vk::ImageLayout::eTransferSrcOptimal,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+      VK_QUEUE_FAMILY_IGNORED,
+      VK_QUEUE_FAMILY_IGNORED,
+      *depthImage,
+      depthRange);
+    const vk::MemoryBarrier copyBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+      {},
+      copyBarrier,
+      nullptr,
+      toAttachment);
+
+    // Every level keeps the farthest depth of the texels it covers, so a box in front of it is in front of all of them
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_reductionPipeline);
+    glm::uvec2 sourceSize = header.depthSize;
+    for (u32 level = 0u; level < header.levelCount; ++level) {
+        const glm::uvec2 targetSize = (sourceSize + 1u) / 2u;
+
+        const std::array offsets {
+          DynamicOffset {pyramidReductionBindingPoint, frameAllocator.getReserved(m_reductionReservations [level], frameIndex).offset},
+          DynamicOffset {occlusionCullingBindingPoint,          cullingDataOffset}
+        };
+        commandBuffer.bindDescriptorSets(
+          vk::PipelineBindPoint::eCompute, *m_pipelineLayout, 0u, {*m_descriptorSets [frameIndex]}, orderDynamicOffsets(m_slots, offsets));
+        commandBuffer.dispatch((targetSize.x + reductionGroupSize - 1u) / reductionGroupSize, (targetSize.y + reductionGroupSize - 1u) / reductionGroupSize, 1);
+
+        const vk::MemoryBarrier levelBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, levelBarrier, nullptr, nullptr);
+        sourceSize = targetSize;
+    }
+
+    if (!cullCandidates) {
+        return;
+    }
+
+    // The section culling counted the groups for its candidates, the descriptor set is still bound from the last level
+    const auto* occlusionCount = m_renderer->getGlobalBuffer(GlobalBuffers::OcclusionCount);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_cullingPipeline);
+    commandBuffer.dispatchIndirect(**occlusionCount, offsetof(OcclusionCounters, candidateGroupCountX));
+
+    const vk::MemoryBarrier lateBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eTransferRead);
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer, {}, lateBarrier, nullptr, nullptr);
+
+    const vk::DeviceSize readbackOffset = frameIndex * sizeof(OcclusionCounters);
+    commandBuffer.copyBuffer(**occlusionCount, *m_counterReadback.buffer, vk::BufferCopy(0u, readbackOffset, sizeof(OcclusionCounters)));
+    const vk::MemoryBarrier readbackBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
+}
+}   // namespace dnm
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Core/Config.hpp>
+#include <Core/Handle.hpp>
+
+#include <Rendering/Renderer.hpp>
+
+namespace dnm
+{
+class Camera;
+class ShaderManager;
+class StringInterner;
+
+// Second phase of the occlusion culling, recorded by the ForwardRenderingNode between its early and late draws.
+// Reduces the depth of the early draws into the depth pyramid of the frame in flight and emits the draw commands of the
+// sections which the section culling rejected with the pyramid of an earlier frame, but which are visible in this one.
+class OcclusionCullingPass {
+    public:
+    explicit OcclusionCullingPass(Config* config, Renderer* renderer, ShaderManager* shaderManager, StringInterner* interner);
+
+    // Reloads the shaders, follows the extent and writes the culling data of the current frame in flight
+    void prepare(const Camera* camera, bool cullCandidates);
+    // Has to be recorded outside of a render pass, the depth buffer is expected and left in the attachment layout.
+    // Only depends on the frame in flight and the recording version, so the command buffer can be submitted again.
+    void record(const vk::raii::CommandBuffer& commandBuffer, bool cullCandidates) const;
+
+    const vk::raii::Buffer& getLateDrawCommands() const;
+    // Bumped whenever the pipelines, descriptors or the extent change
+    u32                     getRecordingVersion() const;
+
+    private:
+    void recreatePipeline();
+    void recompileShadersIfNecessary(bool force = false);
+    void recreateDepthCopy();
+    void plotOcclusionCounters() const;
+
+    Config*         m_config;
+    Renderer*       m_renderer;
+    ShaderManager*  m_shaderManager;
+    StringInterner* m_interner;
+
+    ShaderHandle m_reductionHandle;
+    ShaderHandle m_cullingHandle;
+
+    vk::raii::ShaderModule m_reductionModule {nullptr};
+    vk::raii::ShaderModule m_cullingModule {nullptr};
+
+    // The depth buffer as floats, level 0 of the pyramid is reduced from it
+    dnm::BufferData m_depthCopyBuffer {nullptr};
+    vk::Extent2D    m_depthCopyExtent {};
+    dnm::BufferData m_lateDrawCommandBuffer {nullptr};
+    // One copy of the occlusion counters per frame in flight
+    dnm::BufferData m_counterReadback {nullptr};
+
+    std::vector<BindingSlot>      m_slots;
+    vk::raii::DescriptorSetLayout m_descriptorSetLayout {nullptr};
+    vk::raii::PipelineLayout      m_pipelineLayout {nullptr};
+    // One per frame in flight, each with the depth pyramid and the candidates of its frame
+    std::vector<vk::raii::DescriptorSet> m_descriptorSets;
+
+    vk::raii::Pipeline m_reductionPipeline {nullptr};
+    vk::raii::Pipeline m_cullingPipeline {nullptr};
+
+    // The culling matrix and one reduction per pyramid level
+    FrameAllocator::Reservation                                     m_cullingDataReservation;
+    std::array<FrameAllocator::Reservation, maxDepthPyramidLevels> m_reductionReservations;
+
+    // Global buffers the descriptor set was written with
+    u32 m_globalBufferVersion = 0u;
+    u32 m_recordingVersion    = 0u;
+};
+}   // namespace dnm
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+#include <Core/StringInterner.hpp>
+
+#include <Shader/ShaderManager.hpp>
+#include <Shader/ShaderPermutations.hpp>
+
+namespace
+{
+    // Compiles every permutation through an empty disk cache and then once more through the filled one
+    int timeShaderCache() {
+        using namespace dnm;
+        const auto      cacheDirectory = std::filesystem::temp_directory_path() / "DefinitelyNotMinecraftShaderCacheTiming";
+        std::error_code error;
+        std::filesystem::remove_all(cacheDirectory, error);
+
+        auto compileAll = [&cacheDirectory](std::string_view label)
+        {
+            StringInterner interner;
+            ShaderManager  shaderManager {&interner, shaderPermutations, cacheDirectory, ShaderManager::Mode::Offline};
+
+            const auto begin = std::chrono::steady_clock::now();
+            for (const auto& permutation : shaderPermutations) {
+                if (!shaderManager.getCachedSpirv(shaderManager.registerShaderFile(permutation))) {
+                    std::cerr << "Failed to compile " << permutation.filePath << "\n";
+                    return false;
+                }
+            }
+            const auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            const auto statistics   = shaderManager.getCacheStatistics();
+            std::cout << std::format("{} shader cache: {:.1f} ms, {} cached and {} compiled\n", label, milliseconds, statistics.hits, statistics.compilations);
+            return true;
+        };
+
+        const bool succeeded = compileAll("Cold") && compileAll("Warm");
+        std::filesystem::remove_all(cacheDirectory, error);
+        return succeeded ? 0 : 1;
+    }
+}   // namespace
+
+// Build step, compiles every entry of shaderPermutations and writes the SPIR-V into a header together with the cache
+// key the ShaderManager computes at runtime. Runs from the source directory so the shader paths resolve, but keeps
+// its cache in the given build directory. With --time-cache it only reports how long the permutations take with a
+// cold and a warm disk cache.
+int main(int argc, char** argv) {
+    using namespace dnm;
+    const bool timeCache = argc == 2 && std::string_view(argv [1]) == "--time-cache";
+    if (argc != 3 && !timeCache) {
+        std::cerr << "Usage: ShaderBaker <output header> <cache directory> | --time-cache\n";
+        return 1;
+    }
+
+    try {
+        if (timeCache) {
+            return timeShaderCache();
+        }
+
+        StringInterner interner;
+        ShaderManager  shaderManager {&interner, shaderPermutations, argv [2], ShaderManager::Mode::Offline};
+
+        std::string arrays;
+        std::string entries;
+        for (u32 i = 0u, size = static_cast<u32>(shaderPermutations.size()); i < size; ++i) {
+            const auto& permutation = shaderPermutations [i];
+            const auto  handle      = shaderManager.registerShaderFile(permutation);
+
+            const auto spirv = shaderManager.compileToSpirv(handle);
+            if (!spirv) {
+                std::cerr << "Failed to compile " << permutation.filePath << "\n";
+                return 1;
+            }
+
+            arrays += std::format("// {}\nconstexpr u32 shader{} [] = {{", permutation.filePath, i);
+            for (size_t word = 0u; word < spirv->size(); ++word) {
+                arrays += std::format("{}0x{:08x}u,", word % 8u == 0u ? "\n  " : " ", (*spirv) [word]);
+            }
+            arrays += "\n};\n\n";
+
+            entries += std::format("  EmbeddedShader {{0x{:016x}ull, shader{}}},\n", shaderManager.getCacheKey(handle), i);
+        }
+
+        std::ofstream header(argv [1], std::ios::binary | std::ios::trunc);
+        header << "// Generated by the ShaderBaker from Shader/ShaderPermutations.hpp, do not edit\n"
+                  "#pragma once\n\n"
+                  "#include <array>\n"
+                  "#include <span>\n\n"
+                  "#include <Core/ShortTypes.hpp>\n\n"
+                  "namespace dnm::embedded\n{\n"
+                  "struct EmbeddedShader\n{\n"
+                  "    u64                  cacheKey;\n"
+                  "    std::span<const u32> spirv;\n"
+                  "};\n\n"
+               << arrays << std::format("constexpr std::array<EmbeddedShader, {}> shaders = {{{{\n", shaderPermutations.size()) << entries
+               << "}};\n}   // namespace dnm::embedded\n";
+
+        if (!header) {
+            std::cerr << "Failed to write " << argv [1] << "\n";
+            return 1;
+        }
+        std::cout << "Embedded " << shaderPermutations.size() << " shader permutations into " << argv [1] << "\n";
+    }
+    catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,13 +1,21 @@
 #include "Shader/ShaderManager.hpp"
 
+#include <algorithm>
 #include <filesystem>
+#include <format>
 #include <fstream>
 #include <iostream>
 
+#include <Core/Math.hpp>
+#include <Core/Profiler.hpp>
 #include <Core/StringInterner.hpp>
 
 #include <shaderc/shaderc.hpp>
 
+#ifdef DNM_EMBEDDED_SHADERS
+#include <Shader/EmbeddedShaders.hpp>
+#endif
+
 namespace dnm
 {
 namespace
@@ -72,6 +80,87 @@ namespace
     constexpr std::string_view lineEndViewEnd    = "\"\r\n";
     constexpr std::string_view lineEnding        = "\r\n";
 
+    // Part of the cache key, has to change together with the options below. Release builds and the ShaderBaker
+    // optimize, so the SPIR-V embedded at build time is found under the same key at runtime.
+#ifdef DNM_OPTIMIZE_SHADERS
+    constexpr std::string_view           compileOptionsKey = "glsl 460 core, vulkan 1.2, spirv 1.3, optimized for performance";
+    constexpr shaderc_optimization_level optimizationLevel = shaderc_optimization_level_performance;
+#else
+    constexpr std::string_view           compileOptionsKey = "glsl 460 core, vulkan 1.2, spirv 1.3, no optimization";
+    constexpr shaderc_optimization_level optimizationLevel = shaderc_optimization_level_zero;
+#endif
+
+    shaderc::CompileOptions makeCompileOptions() {
+        shaderc::CompileOptions options;
+        options.SetForcedVersionProfile(460, shaderc_profile_core);
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+        options.SetOptimizationLevel(optimizationLevel);
+        options.SetTargetSpirv(shaderc_spirv_version_1_3);
+        return options;
+    }
+
+    // shaderc has no version query of its own, it is linked from the Vulkan SDK whose headers we compile against
+    u64 hashCompiler(u64 hash) {
+        unsigned int spirvVersion  = 0u;
+        unsigned int spirvRevision = 0u;
+        shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+        return hashFnv1a(std::format("{}, spirv {} revision {}, sdk {}", compileOptionsKey, spirvVersion, spirvRevision, VK_HEADER_VERSION_COMPLETE), hash);
+    }
+
+    std::optional<std::vector<u32>> readCachedSpirv(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return {};
+        }
+
+        const size_t fileSize = static_cast<size_t>(file.tellg());
+        if (fileSize == 0u || fileSize % sizeof(u32) != 0u) {
+            return {};
+        }
+        std::vector<u32> spirv(fileSize / sizeof(u32));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(spirv.data()), static_cast<std::streamsize>(fileSize));
+
+        constexpr u32 spirvMagicNumber = 0x07230203u;
+        if (!file || spirv.front() != spirvMagicNumber) {
+            return {};
+        }
+        return spirv;
+    }
+
+    void writeCachedSpirv(const std::filesystem::path& path, std::span<const u32> spirv) {
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        // Renamed once complete, so an interrupted write never looks like a valid entry
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        bool written = false;
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size_bytes()));
+            written = static_cast<bool>(file);
+        }
+        if (written) {
+            std::filesystem::rename(temporaryPath, path, error);
+        }
+        if (!written || error) {
+            std::cout << "Failed to write the shader cache entry " << path << "\n";
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+#ifdef DNM_EMBEDDED_SHADERS
+    std::optional<std::span<const u32>> findEmbeddedSpirv(u64 cacheKey) {
+        for (const auto& shader : embedded::shaders) {
+            if (shader.cacheKey == cacheKey) {
+                return shader.spirv;
+            }
+        }
+        return {};
+    }
+#endif
+
     void printShaderContent(std::string_view shader) {
         size_t lineCount = 1u;
         size_t start     = 0ull;
@@ -86,7 +175,28 @@ namespace
     }
 }   // namespace
 
-ShaderManager::ShaderManager(StringInterner* interner) : m_interner {interner}, m_reflector {interner} {
+ShaderManager::ShaderManager(StringInterner*                    interner,
+                             std::span<const ShaderPermutation> permutations,
+                             const std::filesystem::path&       cacheDirectory,
+                             Mode                               mode) :
+    m_interner {interner},
+    m_reflector {interner},
+    m_permutations {permutations},
+    // Other compilers and options never hit the entries, but they are kept out of reach of each other's pruning
+    m_cacheDirectory {cacheDirectory / std::format("{:016x}", hashCompiler(fnv1aOffsetBasis))},
+    m_mode {mode} {
+    for (const auto& permutation : m_permutations) {
+        const auto handle = registerShaderFile(m_interner->addOrGetString(permutation.filePath), permutation.shaderStage, {});
+        m_permutationHandles.emplace_back(handle);
+        for (const auto& define : permutation.defines) {
+            m_shaders [handle.index].defines.push_back(Define {m_interner->addOrGetString(define.name), std::string(define.value)});
+        }
+    }
+
+    if (m_mode == Mode::Offline) {
+        return;
+    }
+
     m_running.store(true);
     m_watcher = std::thread(
       [this]()
@@ -113,13 +223,21 @@ ShaderManager::ShaderManager(StringInterner* interner) : m_interner {interner},
 }
 
 ShaderManager::~ShaderManager() {
+    if (m_mode == Mode::Offline) {
+        return;
+    }
+
     m_running.store(false);
     m_watcher.join();
+    pruneCache();
 }
 
-ShaderHandle ShaderManager::registerShaderFile(InternedString filePath, vk::ShaderStageFlagBits shaderStage) {
+ShaderHandle ShaderManager::registerShaderFile(const ShaderPermutation& permutation) {
+    // Anything outside of the permutations would silently miss the SPIR-V embedded at build time
+    assert(std::ranges::any_of(m_permutations, [&permutation](const ShaderPermutation& known) { return known.filePath == permutation.filePath; }));
+
     std::lock_guard guard(m_mutex);
-    return registerShaderFile(filePath, shaderStage, {});
+    return registerShaderFile(m_interner->addOrGetString(permutation.filePath), permutation.shaderStage, {});
 }
 
 void ShaderManager::getBindingSlots(std::span<InternedString> filePaths, std::vector<BindingSlot>& slots, vk::ShaderStageFlags& stageFlags) {
@@ -246,9 +364,90 @@ void ShaderManager::getBindingSlots(InternedString filePath, std::vector<Binding
     }
 }
 
-std::optional<vk::raii::ShaderModule> ShaderManager::getCompiledVersion(const vk::raii::Device& device, ShaderHandle handle, std::span<Define> defines) const {
+std::optional<vk::raii::ShaderModule> ShaderManager::getCompiledVersion(const vk::raii::Device& device, ShaderHandle handle) const {
+    ZoneScoped;
     assert(handle.index < m_shaders.size());
 
+    const auto completeShader = expandIncludes(handle);
+    const u64  cacheKey       = getCacheKey(completeShader, handle);
+
+#ifdef DNM_EMBEDDED_SHADERS
+    if (const auto embeddedSpirv = findEmbeddedSpirv(cacheKey)) {
+        ++m_cacheStatistics.embedded;
+        TracyPlot("Shader Embedded Hits", static_cast<i64>(m_cacheStatistics.embedded));
+        return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), *embeddedSpirv));
+    }
+#endif
+
+    const auto spirv = getCachedSpirv(completeShader, handle, cacheKey);
+    if (!spirv) {
+        return {};
+    }
+    return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), *spirv));
+}
+
+std::optional<std::vector<u32>> ShaderManager::getCachedSpirv(ShaderHandle handle) const {
+    assert(handle.index < m_shaders.size());
+    const auto completeShader = expandIncludes(handle);
+    return getCachedSpirv(completeShader, handle, getCacheKey(completeShader, handle));
+}
+
+std::optional<std::vector<u32>> ShaderManager::getCachedSpirv(const std::string& completeShader, ShaderHandle handle, u64 cacheKey) const {
+    const auto cachePath = getCachePath(cacheKey);
+
+    if (auto cachedSpirv = readCachedSpirv(cachePath)) {
+        ++m_cacheStatistics.hits;
+        TracyPlot("Shader Cache Hits", static_cast<i64>(m_cacheStatistics.hits));
+        return cachedSpirv;
+    }
+
+    auto spirv = compileToSpirv(completeShader, handle);
+    if (!spirv) {
+        return {};
+    }
+
+    writeCachedSpirv(cachePath, *spirv);
+    ++m_cacheStatistics.compilations;
+    TracyPlot("Shader Compilations", static_cast<i64>(m_cacheStatistics.compilations));
+    return spirv;
+}
+
+std::filesystem::path ShaderManager::getCachePath(u64 cacheKey) const {
+    return m_cacheDirectory / std::format("{:016x}.spv", cacheKey);
+}
+
+void ShaderManager::pruneCache() const {
+    ZoneScoped;
+    // Edited shaders leave their earlier versions behind, only what the permutations compile to now is kept
+    std::vector<std::filesystem::path> keptEntries;
+    for (const auto handle : m_permutationHandles) {
+        keptEntries.emplace_back(getCachePath(getCacheKey(handle)));
+    }
+
+    std::error_code                    error;
+    std::vector<std::filesystem::path> staleEntries;
+    // Runs on destruction, so nothing in here may throw
+    for (std::filesystem::directory_iterator it(m_cacheDirectory, error), end; !error && it != end; it.increment(error)) {
+        if (std::ranges::find(keptEntries, it->path()) == keptEntries.end()) {
+            staleEntries.emplace_back(it->path());
+        }
+    }
+    for (const auto& staleEntry : staleEntries) {
+        std::filesystem::remove(staleEntry, error);
+    }
+}
+
+u64 ShaderManager::getCacheKey(ShaderHandle handle) const {
+    assert(handle.index < m_shaders.size());
+    return getCacheKey(expandIncludes(handle), handle);
+}
+
+std::optional<std::vector<u32>> ShaderManager::compileToSpirv(ShaderHandle handle) const {
+    assert(handle.index < m_shaders.size());
+    return compileToSpirv(expandIncludes(handle), handle);
+}
+
+std::string ShaderManager::expandIncludes(ShaderHandle handle) const {
     auto completeShader = m_shaders [handle.index].shaderContent;
 
     for (auto includeHandle : m_shaders [handle.index].includes) {
@@ -264,22 +463,35 @@ std::optional<vk::raii::ShaderModule> ShaderManager::getCompiledVersion(const vk
         completeShader.replace(includeStart, includeLength, m_shaders [includeHandle.index].shaderContent);
     }
 
-    const shaderc::Compiler compiler;
-    shaderc::CompileOptions options;
-    options.SetForcedVersionProfile(460, shaderc_profile_core);
-    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
-    options.SetOptimizationLevel(shaderc_optimization_level_zero);
-    options.SetTargetSpirv(shaderc_spirv_version_1_3);
+    return completeShader;
+}
 
-    for (auto& define : defines) {
-        auto name = m_interner->getStringView(define.defineName);
-        options.AddMacroDefinition(name.data(), name.size(), define.defineValue.data(), define.defineValue.size());
+u64 ShaderManager::getCacheKey(const std::string& completeShader, ShaderHandle handle) const {
+    const auto shaderKind = translateShaderStage(m_shaders [handle.index].shaderStage);
+
+    // Shaders embed their bindings, so the expanded source already covers the binding slots
+    u64 cacheKey = hashCompiler(hashFnv1a(completeShader));
+    cacheKey     = hashFnv1a(std::to_string(static_cast<u32>(shaderKind)), cacheKey);
+    for (const auto& define : m_shaders [handle.index].defines) {
+        cacheKey = hashFnv1a(std::format("{}={};", m_interner->getStringView(define.defineName), define.defineValue), cacheKey);
     }
+    return cacheKey;
+}
 
+std::optional<std::vector<u32>> ShaderManager::compileToSpirv(const std::string& completeShader, ShaderHandle handle) const {
+    ZoneScoped;
     const auto shaderNameString = m_interner->getStringView(m_shaders [handle.index].filePath);
 
     const auto shaderKind = translateShaderStage(m_shaders [handle.index].shaderStage);
 
+    const shaderc::Compiler compiler;
+    shaderc::CompileOptions options = makeCompileOptions();
+
+    for (const auto& define : m_shaders [handle.index].defines) {
+        auto name = m_interner->getStringView(define.defineName);
+        options.AddMacroDefinition(name.data(), name.size(), define.defineValue.data(), define.defineValue.size());
+    }
+
     const auto preprocessed = compiler.PreprocessGlsl(completeShader.c_str(), completeShader.size(), shaderKind, shaderNameString.data(), options);
 
     if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success) {
@@ -297,9 +509,11 @@ std::optional<vk::raii::ShaderModule> ShaderManager::getCompiledVersion(const vk
         return {};
     }
 
-    std::vector spirv(compiling.begin(), compiling.end());
+    return std::vector<u32>(compiling.begin(), compiling.end());
+}
 
-    return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), spirv));
+ShaderManager::CacheStatistics ShaderManager::getCacheStatistics() const {
+    return m_cacheStatistics;
 }
 
 bool ShaderManager::wasContentUpdated(ShaderHandle handle) {
@@ -9,6 +9,7 @@
 #include <vulkan/vulkan_raii.hpp>
 
 #include <Shader/ReflectedShader.hpp>
+#include <Shader/ShaderPermutations.hpp>
 #include <Shader/ShaderReflector.hpp>
 
 namespace dnm
@@ -26,10 +27,23 @@ struct BindingSlot
 
 class ShaderManager {
     public:
-    explicit ShaderManager(StringInterner* interner);
+    enum class Mode
+    {
+        // Watches the shader files for hot reloading and prunes the disk cache on destruction
+        Runtime,
+        // Only compiles, for build steps which must neither wait on the watcher nor touch the cache of the source tree
+        Offline
+    };
+
+    // Every permutation which is compiled later on has to be known up front, see Shader/ShaderPermutations.hpp
+    ShaderManager(StringInterner*                    interner,
+                  std::span<const ShaderPermutation> permutations,
+                  const std::filesystem::path&       cacheDirectory = "ShaderCache",
+                  Mode                               mode           = Mode::Runtime);
     ~ShaderManager();
 
-    ShaderHandle registerShaderFile(InternedString filePath, vk::ShaderStageFlagBits shaderStage);
+    // Has to be one of the permutations the manager was created with, its defines are used whenever it is compiled
+    ShaderHandle registerShaderFile(const ShaderPermutation& permutation);
 
     void getBindingSlots(std::span<InternedString> filePaths, std::vector<BindingSlot>& slots, vk::ShaderStageFlags& stageFlags);
 
@@ -39,18 +53,48 @@ class ShaderManager {
         std::string    defineValue;
     };
 
-    std::optional<vk::raii::ShaderModule> getCompiledVersion(const vk::raii::Device& device, ShaderHandle handle, std::span<Define> defines) const;
+    std::optional<vk::raii::ShaderModule> getCompiledVersion(const vk::raii::Device& device, ShaderHandle handle) const;
+
+    // Device independent halves of getCompiledVersion, the ShaderBaker uses them to embed the SPIR-V at build time
+    u64                             getCacheKey(ShaderHandle handle) const;
+    std::optional<std::vector<u32>> compileToSpirv(ShaderHandle handle) const;
+    // Through the disk cache, compiling and caching on a miss
+    std::optional<std::vector<u32>> getCachedSpirv(ShaderHandle handle) const;
+
+    // Removes the cache entries none of the permutations maps to anymore, also done on destruction in the runtime mode
+    void pruneCache() const;
 
     bool wasContentUpdated(ShaderHandle handle);
 
+    struct CacheStatistics
+    {
+        u32 embedded     = 0u;
+        u32 hits         = 0u;
+        u32 compilations = 0u;
+    };
+
+    // Compiled SPIR-V is cached on the disk, keyed by the expanded source, the defines and the compiler.
+    // Release builds look the same key up in the SPIR-V embedded at build time first.
+    CacheStatistics getCacheStatistics() const;
+
     void update();
 
     private:
     ShaderHandle registerShaderFile(InternedString filePath, vk::ShaderStageFlagBits shaderStage, std::optional<ShaderHandle> includer);
     void         getBindingSlots(InternedString filePath, std::vector<BindingSlot>& slots);
 
-    StringInterner* m_interner;
-    ShaderReflector m_reflector;
+    std::string                     expandIncludes(ShaderHandle handle) const;
+    u64                             getCacheKey(const std::string& completeShader, ShaderHandle handle) const;
+    std::optional<std::vector<u32>> compileToSpirv(const std::string& completeShader, ShaderHandle handle) const;
+    std::optional<std::vector<u32>> getCachedSpirv(const std::string& completeShader, ShaderHandle handle, u64 cacheKey) const;
+    std::filesystem::path           getCachePath(u64 cacheKey) const;
+
+    StringInterner*                    m_interner;
+    ShaderReflector                    m_reflector;
+    std::span<const ShaderPermutation> m_permutations;
+    std::vector<ShaderHandle>          m_permutationHandles;
+    std::filesystem::path              m_cacheDirectory;
+    Mode                               m_mode;
 
     struct Shader
     {
@@ -64,10 +108,14 @@ class ShaderManager {
         std::vector<ShaderHandle>                        includedBy;
         std::vector<ShaderHandle>                        includes;
         std::vector<BindingSlot>                         slots;
+        std::vector<Define>                              defines;
     };
 
     std::vector<Shader> m_shaders;
 
+    // Shaders are only compiled on the main thread
+    mutable CacheStatistics m_cacheStatistics;
+
     // Shader watcher related
     std::mutex        m_mutex;
     std::thread       m_watcher;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include <vulkan/vulkan.hpp>
+
+#include <Core/ShortTypes.hpp>
+
+#include <Rendering/GlobalBuffers.hpp>
+
+namespace dnm
+{
+struct PermutationDefine
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+struct ShaderPermutation
+{
+    std::string_view                   filePath;
+    vk::ShaderStageFlagBits            shaderStage;
+    std::span<const PermutationDefine> defines;
+};
+
+// Decimal digits of a constant, so a define and the C++ side can't disagree about its value
+struct DefineText
+{
+    std::array<char, 10> digits {};
+    u32                  length = 0u;
+
+    constexpr std::string_view view() const {
+        return {digits.data(), length};
+    }
+};
+
+constexpr DefineText toDefineText(u32 value) {
+    DefineText text;
+    do {
+        text.digits [text.length++] = static_cast<char>('0' + value % 10u);
+        value /= 10u;
+    } while (value != 0u);
+    for (u32 i = 0u; i < text.length / 2u; ++i) {
+        std::swap(text.digits [i], text.digits [text.length - 1u - i]);
+    }
+    return text;
+}
+
+inline constexpr DefineText chunkSlotBitsText = toDefineText(chunkSlotBits);
+
+// Every shader which includes Shaders/PackedFace.glsl
+inline constexpr std::array packedFaceDefines = {
+  PermutationDefine {"CHUNK_SLOT_BITS", chunkSlotBitsText.view()}
+};
+
+// One invocation per block column of a chunk, has to match BlockWorld::chunkLocalSize
+inline constexpr std::array drawCallGenerationDefines = {
+  PermutationDefine {   "LOCAL_SIZE_X",                       "32"},
+  PermutationDefine {   "LOCAL_SIZE_Y",                        "1"},
+  PermutationDefine {   "LOCAL_SIZE_Z",                       "32"},
+  PermutationDefine {"CHUNK_SLOT_BITS", chunkSlotBitsText.view()}
+};
+
+// Nodes register their shaders through these, so the path and the defines are the ones the ShaderBaker compiled
+inline constexpr ShaderPermutation drawCallGenerationShader {"Shaders/DrawCallGenerationWorld.comp", vk::ShaderStageFlagBits::eCompute, drawCallGenerationDefines};
+inline constexpr ShaderPermutation sectionCullingShader {"Shaders/SectionCulling.comp", vk::ShaderStageFlagBits::eCompute, {}};
+inline constexpr ShaderPermutation depthPyramidShader {"Shaders/DepthPyramid.comp", vk::ShaderStageFlagBits::eCompute, {}};
+inline constexpr ShaderPermutation occlusionCullingShader {"Shaders/OcclusionCulling.comp", vk::ShaderStageFlagBits::eCompute, {}};
+inline constexpr ShaderPermutation worldVertexShader {"Shaders/World.vert", vk::ShaderStageFlagBits::eVertex, packedFaceDefines};
+inline constexpr ShaderPermutation greedyWorldVertexShader {"Shaders/GreedyWorld.vert", vk::ShaderStageFlagBits::eVertex, packedFaceDefines};
+inline constexpr ShaderPermutation worldFragmentShader {"Shaders/World.frag", vk::ShaderStageFlagBits::eFragment, {}};
+inline constexpr ShaderPermutation gizmoVertexShader {"Shaders/Gizmo.vert", vk::ShaderStageFlagBits::eVertex, {}};
+inline constexpr ShaderPermutation gizmoFragmentShader {"Shaders/Gizmo.frag", vk::ShaderStageFlagBits::eFragment, {}};
+
+// Handed to the ShaderManager, which registers them in this order before anything else. That keeps the injected binding
+// slots and with them the SPIR-V the same for the ShaderBaker at build time and the game at runtime.
+inline constexpr std::array shaderPermutations = {
+  drawCallGenerationShader,
+  sectionCullingShader,
+  depthPyramidShader,
+  occlusionCullingShader,
+  worldVertexShader,
+  greedyWorldVertexShader,
+  worldFragmentShader,
+  gizmoVertexShader,
+  gizmoFragmentShader};
+}   // namespace dnm
@@ -1,39 +1,55 @@
-struct DrawCall
+// Every resident chunk owns a range of this pool, which is only rewritten when the chunk changes.
+// The vertex shader reads the faces straight from here, one draw command per visible section.
+layout (std430, binding = ) buffer residentFaceBuffer
 {
-    uint vertexCount;
-    uint instanceCount;
-    uint firstVertex;
-    uint firstInstance;
-    uint globalIndexTransform;
-    uint globalIndexFace;
+    uint residentFaces[];
 };
 
-layout (std140, binding = ) buffer transformBuffer
+struct FaceRange
 {
-    vec4 transforms[];
+    uint offset;
+    uint count;
 };
 
-struct BlockData{
-    uint index;
-    uint8_t blockType;
-    uint8_t visibleFace;
-    uint8_t padding;
-    uint8_t padding2;
+const uint faceDirectionCount = 6u;
+
+// Ranges of every face direction of every section, the sections of a slot are stored next to each other
+layout (std430, binding = ) readonly buffer sectionRangeBuffer
+{
+    FaceRange sectionRanges[];
 };
 
-layout (std430, binding = ) buffer blockTypeBuffer
+// Write position within every range of the sections which are regenerated
+layout (std430, binding = ) buffer faceCursorBuffer
 {
-    BlockData blockData[];
+    uint faceCursors[];
 };
 
-layout (std430, binding = ) readonly buffer worldDataBuffer
+// One draw command per face direction of a section inside the frustum which holds faces
+layout (std430, binding = ) writeonly buffer drawCallBuffer
 {
-    uint16_t blockTypeWorld[];
+    DrawCommand drawCommands[];
+};
+
+layout (std430, binding = ) buffer drawCountBuffer
+{
+    uint drawCount;
+    uint visibleFaces;
+    // Sections which hold faces, whether they are visible or not
+    uint occupiedSections;
+    // Faces skipped because their direction points away from the camera for the whole section
+    uint backFacingFaces;
+};
+
+// World space block coordinates of the chunk in each slot
+layout (std430, binding = ) readonly buffer chunkOriginBuffer
+{
+    ivec2 chunkOrigins[];
 };
 
-layout (binding = ) buffer drawCallBuffer
+layout (std430, binding = ) readonly buffer worldDataBuffer
 {
-    DrawCall drawcall;
+    uint16_t blockTypeWorld[];
 };
 
 layout (binding = ) readonly uniform chunkConstants
@@ -42,8 +58,10 @@ layout (binding = ) readonly uniform chunkConstants
     int chunksOneDimension;
     int chunkLocalSize;
     int chunkHeight;
+    int sectionHeight;
 };
 
+// Layers of the regenerated slots which hold exposed faces as slot * chunkHeight + layer, one entry per workgroup
 layout (binding = ) readonly buffer chunkIndexRemap
 {
     uint remapIndex[];
@@ -57,6 +75,10 @@ struct Plane
 
 layout (binding = ) readonly uniform cullingData
 {
+	mat4 cullingViewProjection;
 	Plane planes[6];
+	vec3 cullingCameraPosition;
 	uint cullingEnabled;
+	uint faceCullingEnabled;
+	uint occlusionCullingEnabled;
 };
\ No newline at end of file
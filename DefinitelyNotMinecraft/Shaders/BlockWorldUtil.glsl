@@ -1,14 +1,10 @@
 const uint air = uint(65535);
 
-vec3 indexToPos()
+vec3 indexToPos(uint slot)
 {
-  int remap = int(remapIndex[gl_WorkGroupID.x]);
-  int remapOffsetX = (remap % chunksOneDimension) - chunkLoadCount;
-  int remapOffsetZ = (remap / chunksOneDimension) - chunkLoadCount;
-  int chunkStartX = int(chunkLocalSize * (remapOffsetX + int(cameraPos.x / chunkLocalSize)));
-  int chunkStartZ = int(chunkLocalSize * (remapOffsetZ + int(cameraPos.z / chunkLocalSize)));
-  int x = int(gl_LocalInvocationID.x) + chunkStartX;
-  int z = int(gl_LocalInvocationID.z) + chunkStartZ;
+  ivec2 chunkOrigin = chunkOrigins[slot];
+  int x = int(gl_LocalInvocationID.x) + chunkOrigin.x;
+  int z = int(gl_LocalInvocationID.z) + chunkOrigin.y;
 
   return vec3(x, gl_WorkGroupID.y, z);
 }
@@ -18,21 +14,14 @@ bool isInsideChunk(ivec3 position)
     return position.y >= 0 && position.y < chunkHeight && position.x >= 0 && position.x < chunkLocalSize && position.z >= 0 && position.z < chunkLocalSize;
 }
 
-uint toFlatIndex(ivec3 position)
+uint toFlatIndex(uint slot, ivec3 position)
 {
-  int remap = int(remapIndex[gl_WorkGroupID.x]);
-  int chunkStartX = (remap % chunksOneDimension);
-  int chunkStartZ = (remap / chunksOneDimension);
-  
   int heightOffset = chunkLocalSize * chunkLocalSize * position.y;
-  
   int sizeOfChunk = chunkLocalSize * chunkLocalSize * chunkHeight;
-  int offsetPreviousChunk = chunkStartX * sizeOfChunk + chunkStartZ * chunksOneDimension * sizeOfChunk;
-   
-   // Convert any world space positions into chunk local positions
-  int inLayerOffset = (position.z % chunkLocalSize) * chunkLocalSize + (position.x % chunkLocalSize);
 
-  return offsetPreviousChunk + heightOffset + inLayerOffset;
+  int inLayerOffset = position.z * chunkLocalSize + position.x;
+
+  return int(slot) * sizeOfChunk + heightOffset + inLayerOffset;
 }
 
 float getSignedDistanceToPlane(const vec3 point, const Plane plane)
@@ -40,13 +29,13 @@ float getSignedDistanceToPlane(const vec3 point, const Plane plane)
     return dot(plane.normal, point) - plane.dist;
 }
 
-bool isVisible(vec3 center, float extent)
+bool isBoxVisible(vec3 center, vec3 extent)
 {
 	bool visible = true;
 
     for(int i = 0; i < 6; ++i)
     {	
-        const float r = dot(abs(planes[i].normal), vec3(extent));
+        const float r = dot(abs(planes[i].normal), extent);
         visible = visible && -r <= getSignedDistanceToPlane(center, planes[i]);
     }
 
@@ -63,22 +52,22 @@ const ivec3 direction[6] = ivec3[](
     ivec3(0, 0, -1)
 );
 
-// Reduce the number of visible faces to avoid z fighting
-uint[6] getVisibleFaces(in ivec3 center, out uint faceCount)
+// Faces between two solid blocks are never exposed, which also avoids z fighting
+bool isFaceExposed(uint blockType, uint dir)
 {
-    faceCount = 0;
-
-    uint[6] result;
-    uint blockType = uint(blockTypeWorld[toFlatIndex(center)]);
+    return (blockType & uint(1) << (16 - 6 + dir)) != 0u;
+}
 
-    for(int i = 0; i < 6; ++i)
+// True if every face of the direction within the box points away from the camera
+bool isFacingAway(uint dir, vec3 boxMin, vec3 boxMax)
+{
+    if (faceCullingEnabled == 0u)
     {
-        if((blockType & uint(1) << (16 - 6 + i)) != 0u)
-        {
-            result[faceCount] = i;
-            ++faceCount;
-        }
+        return false;
     }
 
-    return result;
-}
\ No newline at end of file
+    // Faces sit one block into the box from its near side up to its far side, the one closest to the camera decides
+    vec3 normal = vec3(direction[dir]);
+    vec3 closestFace = mix(boxMax - vec3(1.0f), boxMin + vec3(1.0f), greaterThan(normal, vec3(0.0f)));
+    return dot(normal, cullingCameraPosition - closestFace) <= 0.0f;
+}
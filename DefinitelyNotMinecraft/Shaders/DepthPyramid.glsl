@@ -0,0 +1,70 @@
+const uint maxDepthPyramidLevels = 16u;
+
+// Min reduction of the depth buffer, level 0 has half its size and every level halves the previous one rounding up.
+// The depth is reversed, so every texel holds the farthest depth of the pixels it covers.
+layout (std430, binding = ) buffer depthPyramidBuffer
+{
+    uvec2 depthSize;
+    // Zero until the pyramid was built once
+    uint pyramidLevelCount;
+    uint pyramidPadding;
+    uint pyramidLevelOffsets[maxDepthPyramidLevels];
+    float pyramidDepth[];
+};
+
+uvec2 getPyramidLevelSize(uint level)
+{
+    uint texelSize = 2u << level;
+    return (depthSize + texelSize - 1u) / texelSize;
+}
+
+// True if the box lies behind the depth of the pyramid at every pixel it covers
+bool isBoxOccluded(vec3 boxMin, vec3 boxMax, mat4 viewProjection)
+{
+    if (pyramidLevelCount == 0u)
+    {
+        return false;
+    }
+
+    vec2 screenMin = vec2(1.0f);
+    vec2 screenMax = vec2(0.0f);
+    float nearestDepth = 0.0f;
+    for (uint corner = 0u; corner < 8u; ++corner)
+    {
+        vec3 position = mix(boxMin, boxMax, bvec3(corner & 1u, corner & 2u, corner & 4u));
+        vec4 clip = viewProjection * vec4(position, 1.0f);
+        // Boxes reaching behind the camera are never occluded
+        if (clip.w <= 0.0f)
+        {
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        screenMin = min(screenMin, ndc.xy * 0.5f + 0.5f);
+        screenMax = max(screenMax, ndc.xy * 0.5f + 0.5f);
+        // The viewport flips the depth range, the depth buffer stores 1 at the near plane
+        nearestDepth = max(nearestDepth, 1.0f - ndc.z);
+    }
+
+    uvec2 pixelMin = min(uvec2(clamp(screenMin, 0.0f, 1.0f) * vec2(depthSize)), depthSize - 1u);
+    uvec2 pixelMax = min(uvec2(clamp(screenMax, 0.0f, 1.0f) * vec2(depthSize)), depthSize - 1u);
+
+    // The first level whose texels are at least as large as the box covers it with at most 2x2 texels
+    uvec2 pixelExtent = pixelMax - pixelMin + 1u;
+    uint level = uint(max(findMSB(max(pixelExtent.x, pixelExtent.y) - 1u), 0));
+    level = min(level, pyramidLevelCount - 1u);
+
+    uvec2 levelSize = getPyramidLevelSize(level);
+    uvec2 texelMin = pixelMin >> (level + 1u);
+    uvec2 texelMax = min(pixelMax >> (level + 1u), levelSize - 1u);
+
+    float farthestDepth = 1.0f;
+    for (uint y = texelMin.y; y <= texelMax.y; ++y)
+    {
+        for (uint x = texelMin.x; x <= texelMax.x; ++x)
+        {
+            farthestDepth = min(farthestDepth, pyramidDepth[pyramidLevelOffsets[level] + y * levelSize.x + x]);
+        }
+    }
+    return nearestDepth < farthestDepth;
+}
@@ -0,0 +1,10 @@
+// Layout of VkDrawIndexedIndirectCommand. Every face takes six indices of the shared quad index buffer, the vertex
+// offset points at the four corners of the first face of the drawn range.
+struct DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
@@ -0,0 +1,107 @@
+// Corners, texture sheet coordinates and normals of the six face directions of a block, four corners per face
+
+// Corners of the two triangles of a face, the forward pass draws the faces with an index buffer of this pattern
+const uint quadCorners[6] = uint[](0u, 1u, 2u, 2u, 3u, 0u);
+
+const vec3 vertices[24] = vec3[](
+    vec3(-0.5f, -0.5f, -0.5f),
+    vec3(-0.5f, -0.5f, 0.5f),
+    vec3(-0.5f, 0.5f, 0.5f),
+    vec3(-0.5f, 0.5f, -0.5f),
+
+    vec3(0.5f, 0.5f, 0.5f),
+    vec3(-0.5f, 0.5f, 0.5f),
+    vec3(-0.5f, -0.5f, 0.5f),
+    vec3(0.5f, -0.5f, 0.5f),
+
+    vec3(0.5f, 0.5f, 0.5f),
+    vec3(0.5f, 0.5f, -0.5f),
+    vec3(-0.5f, 0.5f, -0.5f),
+    vec3(-0.5f, 0.5f, 0.5f),
+
+    vec3(0.5f, -0.5f, 0.5f),
+    vec3(-0.5f, -0.5f, 0.5f),
+    vec3(-0.5f, -0.5f, -0.5f),
+    vec3(0.5f, -0.5f, -0.5f),
+
+    vec3(0.5f, 0.5f, -0.5f),
+    vec3(0.5f, 0.5f, 0.5f),
+    vec3(0.5f, -0.5f, 0.5f),
+    vec3(0.5f, -0.5f, -0.5f),
+
+    vec3(0.5f, 0.5f, -0.5f),
+    vec3(0.5f, -0.5f, -0.5f),
+    vec3(-0.5f, -0.5f, -0.5f),
+    vec3(-0.5f, 0.5f, -0.5f)
+);
+
+const float oneSixth = 1.0f / 12.0f;
+const float twoSixth = 2.0f / 12.0f;
+const float threeSixth = 3.0f / 12.0f;
+const float fourSixth = 4.0f / 12.0f;
+const float fiveSixth = 5.0f / 12.0f;
+const float sixSixth = 6.0f / 12.0f;
+
+const float oneTwelveth = 1.0f / 12.0f;
+
+const vec2 uvs[24] =  vec2[]
+(
+    vec2(twoSixth, oneTwelveth),
+    vec2(oneSixth, oneTwelveth),
+    vec2(oneSixth, 0.0f),
+    vec2(twoSixth, 0.0f),
+
+    vec2(threeSixth, 0.0f),
+    vec2(twoSixth, 0.0f),
+    vec2(twoSixth, oneTwelveth),
+    vec2(threeSixth, oneTwelveth),
+
+    vec2(sixSixth, oneTwelveth),
+    vec2(sixSixth, 0.0f),
+    vec2(fiveSixth, 0.0f),
+    vec2(fiveSixth, oneTwelveth),
+
+    vec2(oneSixth, 0.0f),
+    vec2(0.0f, 0.0f),
+    vec2(0.0f, oneTwelveth),
+    vec2(oneSixth, oneTwelveth),
+
+    vec2(threeSixth, 0.0f),
+    vec2(fourSixth, 0.0f),
+    vec2(fourSixth, oneTwelveth),
+    vec2(threeSixth, oneTwelveth),
+
+    vec2(fourSixth, 0.0f),
+    vec2(fourSixth, oneTwelveth),
+    vec2(fiveSixth, oneTwelveth),
+    vec2(fiveSixth, 0.0f)
+);
+
+const vec3 normals[6] =  vec3[]
+(
+    vec3(-1.0f, 0.0f, 0.0f),
+    vec3(0.0f, 0.0f, 1.0f),
+    vec3(0.0f, 1.0f, 0.0f),    
+    vec3(0.0f, -1.0f, 0.0f),
+    vec3(1.0f, 0.0f, 0.0f),
+    vec3(0.0f, 0.0f, -1.0f)
+);
+
+// The texture sheet holds one tile per face direction in each row and one row per block type
+const float tileSize = 1.0f / 12.0f;
+const float tileColumns[6] = float[](1.0f, 2.0f, 5.0f, 0.0f, 3.0f, 4.0f);
+
+// Axes the texture coordinates run along for each face direction
+const uint uAxis[6] = uint[](2u, 0u, 0u, 0u, 2u, 0u);
+const uint vAxis[6] = uint[](1u, 1u, 2u, 2u, 1u, 1u);
+
+vec2 getTileOrigin(uint direction, uint blockType)
+{
+    return vec2(tileColumns[direction], float(blockType)) * tileSize;
+}
+
+// Corner of the vertex within its tile, either 0 or 1 per axis
+vec2 getTileCorner(uint index)
+{
+    return round((uvs[index] - getTileOrigin(index / 4u, 0u)) / tileSize);
+}
@@ -0,0 +1,55 @@
+#include "Shaders/CameraBuffer.glsl"
+#include "Shaders/PackedFace.glsl"
+#include "Shaders/FaceGeometry.glsl"
+
+// A merged quad is the face of its minimum block plus its size along the two texture axes
+struct GreedyQuad
+{
+  uint face;
+  uint size;
+};
+
+layout (std430, binding = ) readonly buffer quadBuffer
+{
+  GreedyQuad quads[];
+};
+
+layout (std430, binding = ) readonly buffer chunkOriginBuffer
+{
+  ivec2 chunkOrigins[];
+};
+
+layout (location = 0) out vec2 outTexCoord;
+layout (location = 1) out vec3 outNormal;
+layout (location = 2) out vec3 outPosition;
+layout (location = 3) out vec3 outWSPos;
+layout (location = 4) flat out vec2 outTileOrigin;
+
+void main()
+{
+  uint quadIndex = uint(gl_VertexIndex / int(6));
+  uint vertex = uint(gl_VertexIndex % int(6));
+  GreedyQuad quad = quads[quadIndex];
+  Face face = unpackFace(quad.face);
+  uint index = face.direction * 4 + quadCorners[vertex];
+
+  vec2 quadSize = vec2(float((quad.size & 31u) + 1u), float((quad.size >> 5) + 1u));
+  vec3 extent = vec3(1.0f);
+  extent[uAxis[face.direction]] = quadSize.x;
+  extent[vAxis[face.direction]] = quadSize.y;
+  // Stretches the unit face from its minimum corner over the merged blocks
+  vec3 corner = (vertices[index] + 0.5f) * extent - 0.5f;
+
+  outTileOrigin = getTileOrigin(face.direction, face.blockType);
+  outTexCoord = getTileCorner(index) * quadSize;
+
+  ivec2 chunkOrigin = chunkOrigins[face.chunkSlot];
+  ivec3 blockPosition = ivec3(chunkOrigin.x, 0, chunkOrigin.y) + ivec3(face.position);
+
+  ivec3 cameraBlock = ivec3(floor(cameraPos.xyz));
+  vec3 relativePosition = vec3(blockPosition - cameraBlock) - (cameraPos.xyz - vec3(cameraBlock)) + corner;
+  gl_Position = projection * vec4(mat3(view) * relativePosition, 1.0f);
+  outNormal = normals[face.direction];
+  outPosition = gl_Position.xyz;
+  outWSPos = vec3(blockPosition) + corner;
+}
@@ -0,0 +1,38 @@
+const uint occlusionGroupSize = 64u;
+
+// Section which was hidden behind an earlier frame's depth, its draw commands are only emitted if it is visible
+// in the depth of the current frame
+struct OcclusionCandidate
+{
+    vec3 boxMin;
+    uint firstDraw;
+    vec3 boxMax;
+    uint drawCount;
+};
+
+layout (std430, binding = ) buffer occlusionCandidateBuffer
+{
+    OcclusionCandidate candidates[];
+};
+
+// Draw commands of the candidates, written up front so the late culling only has to copy them
+layout (std430, binding = ) buffer candidateDrawBuffer
+{
+    DrawCommand candidateDraws[];
+};
+
+layout (std430, binding = ) buffer occlusionCountBuffer
+{
+    // Indirect dispatch of the late culling, one invocation per candidate
+    uint candidateGroupCountX;
+    uint candidateGroupCountY;
+    uint candidateGroupCountZ;
+    uint candidateCount;
+    uint candidateDrawCount;
+    // Sections inside the frustum which were tested against an earlier frame's depth
+    uint testedSections;
+    uint lateDrawCount;
+    // Candidates which turned out visible in the depth of the current frame
+    uint lateVisibleSections;
+    uint lateVisibleFaces;
+};
@@ -0,0 +1,33 @@
+// A visible face packed into 32 bits:
+// x (5) | z (5) | y (7) | face direction (3) | block type (4) | chunk slot (CHUNK_SLOT_BITS)
+// The position is relative to the chunk, its origin is looked up through the chunk slot.
+// CHUNK_SLOT_BITS comes from chunkSlotBits in Rendering/GlobalBuffers.hpp.
+
+#if !defined(CHUNK_SLOT_BITS) || CHUNK_SLOT_BITS > 8
+#error "CHUNK_SLOT_BITS has to be defined and fit above the 24 bits of the other fields"
+#endif
+
+const uint chunkSlotMask = (1u << CHUNK_SLOT_BITS) - 1u;
+
+struct Face
+{
+    uvec3 position;
+    uint direction;
+    uint blockType;
+    uint chunkSlot;
+};
+
+uint packFace(uvec3 position, uint direction, uint blockType, uint chunkSlot)
+{
+    return position.x | (position.z << 5) | (position.y << 10) | (direction << 17) | ((blockType & 15u) << 20) | ((chunkSlot & chunkSlotMask) << 24);
+}
+
+Face unpackFace(uint packedFace)
+{
+    Face face;
+    face.position = uvec3(packedFace & 31u, (packedFace >> 10) & 127u, (packedFace >> 5) & 31u);
+    face.direction = (packedFace >> 17) & 7u;
+    face.blockType = (packedFace >> 20) & 15u;
+    face.chunkSlot = (packedFace >> 24) & chunkSlotMask;
+    return face;
+}
@@ -3,6 +3,7 @@
 #extension GL_ARB_shading_language_420pack : enable
 
 #include "Shaders/CameraBuffer.glsl"
+#include "Shaders/FaceGeometry.glsl"
 
 layout (std140, binding = ) uniform lightConstants
 {
@@ -26,10 +27,12 @@ layout (std140, binding = ) buffer perLightBuffer
 
 layout (binding = ) uniform sampler2D tex;
 
+// Counted in tiles, so merged faces repeat the tile instead of stretching it
 layout (location = 0) in vec2 inTexCoord;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec3 inPosition;
 layout (location = 3) in vec3 inWSPos;
+layout (location = 4) flat in vec2 inTileOrigin;
 
 layout (location = 0) out vec4 outColor;
 
@@ -57,5 +60,8 @@ void main()
         finalResult += ambient + diffuse + specular;
     }
 
-    outColor = vec4(finalResult * (texture(tex, inTexCoord)).xyz, 1.0f);
+    // The gradients of the unwrapped coordinates keep the mip selection stable across tile borders
+    vec2 texCoord = inTileOrigin + fract(inTexCoord) * tileSize;
+    vec4 albedo = textureGrad(tex, texCoord, dFdx(inTexCoord) * tileSize, dFdy(inTexCoord) * tileSize);
+    outColor = vec4(finalResult * albedo.xyz, 1.0f);
 }
\ No newline at end of file